@@ -7,6 +7,46 @@
 
 namespace ecs {
 
-// Currently no configurables
+// Size in bytes of the blocks that chunks store their entities in
+// - Each block holds the arrays of every component in the chunk back to back
+// - Chunks whose entities are too large to fit ECS_CHUNK_LANE_COUNT of them in a block
+//   use blocks enlarged to hold that many
+#ifndef ECS_CHUNK_BLOCK_SIZE
+#define ECS_CHUNK_BLOCK_SIZE (16 * 1024)
+#endif
+
+// Size in bytes of the blocks that queued commands are written into
+// - Commands are written one after another with their components, blocks are
+//   kept and reused once a queue has been applied
+// - Commands larger than this get a block that fits them
+#ifndef ECS_COMMAND_BLOCK_SIZE
+#define ECS_COMMAND_BLOCK_SIZE (16 * 1024)
+#endif
+
+// Alignment in bytes of every component array within a chunk block
+// - Defaults to a cache line, which also satisfies AVX-512 aligned loads
+#ifndef ECS_CHUNK_ARRAY_ALIGNMENT
+#define ECS_CHUNK_ARRAY_ALIGNMENT 64
+#endif
+
+// Chunk block capacities are always a multiple of this many entities
+// - Lets ForEachChunk process arrays in whole vectors with no scalar tail,
+//   see Job::GetChunkPaddedEntityCount
+// - Blocks are enlarged past ECS_CHUNK_BLOCK_SIZE if needed to fit this many entities
+#ifndef ECS_CHUNK_LANE_COUNT
+#define ECS_CHUNK_LANE_COUNT 16
+#endif
+
+// Maximum number of distinct component types, including singletons
+// - Component flags are fixed-size bitsets of this many bits
+#ifndef ECS_MAX_COMPONENT_TYPES
+#define ECS_MAX_COMPONENT_TYPES 256
+#endif
+
+// Maximum number of shared components on a single entity, see ECS_SHARED_COMPONENT
+// - Every chunk stores the values of this many shared components in its composition
+#ifndef ECS_MAX_SHARED_COMPONENTS
+#define ECS_MAX_SHARED_COMPONENTS 4
+#endif
 
 }
@@ -7,7 +7,13 @@
 
 #include "inc/entity.h"
 #include "inc/component.h"
+#include "inc/filter.h"
 #include "inc/job.h"
+#include "inc/job_handle.h"
+#include "inc/job_signature.h"
 #include "inc/manager.h"
+#include "inc/query.h"
+#include "inc/scheduler.h"
+#include "inc/update_group.h"
 
 #include "inc/inline/inline.inl"
@@ -0,0 +1,38 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "../config.h"
+#include "component_collection.h"
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+namespace ecs {
+namespace impl {
+
+// - Recycles chunk blocks between every chunk in a Manager
+// - Blocks that fit within ECS_CHUNK_BLOCK_SIZE are pooled, so memory freed
+//   by one composition is reused by the next one that needs a block
+// - Larger or over-aligned blocks go straight to the memory resource
+struct BlockPool {
+    BlockPool (std::pmr::memory_resource* resource);
+    ~BlockPool ();
+
+    byte_t* Allocate (size_t size, size_t alignment);
+    void Free (byte_t* block, size_t size, size_t alignment);
+
+private:
+    static bool IsPooled (size_t size, size_t alignment);
+
+private:
+    std::pmr::memory_resource* m_resource;
+    std::pmr::vector<byte_t*> m_freeBlocks;
+};
+
+} // namespace impl
+} // namespace ecs
@@ -0,0 +1,29 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace ecs {
+namespace impl {
+
+// - A Manager's clock for change tracking, see ECS_CHANGED
+// - Every job run and every structural change to a chunk takes a new version
+// - Versions wrap, compare them with IsNewerVersion
+struct ChangeVersion {
+    uint32_t Next ();
+
+private:
+    std::atomic<uint32_t> m_value{ 0 };
+};
+
+// - True if version was taken after since
+// - Correct as long as the two are less than 2^31 versions apart
+bool IsNewerVersion (uint32_t version, uint32_t since);
+
+} // namespace impl
+} // namespace ecs
@@ -5,39 +5,122 @@
 
 #pragma once
 
+#include "../config.h"
+#include "block_pool.h"
+#include "change_version.h"
 #include "composition.h"
 #include "component_collection.h"
+#include "component_registry.h"
+#include "shared_component_store.h"
 
+#include <chrono>
 #include <cstdint>
+#include <memory_resource>
 #include <unordered_map>
+#include <vector>
 
 namespace ecs {
 namespace impl {
 
-typedef uint8_t byte_t;
-
+// - Stores every entity of a single composition
+// - Entities are stored in fixed-size blocks, each holding the arrays of all
+//   of the chunk's components back to back
+// - Entity indices are contiguous across blocks, every block but the last is full
+// - Arrays are aligned to ECS_CHUNK_ARRAY_ALIGNMENT and block capacities are
+//   a multiple of ECS_CHUNK_LANE_COUNT
+// - Blocks come from the owning Manager's block pool, bookkeeping from its memory resource
+// - Shared components have no arrays, the chunk points at the one interned value
+// - Adding, removing, or moving entities takes a new structural version from the
+//   Manager's ChangeVersion, writes to component arrays are versioned per array
 struct Chunk {
-    Chunk (const Composition& composition);
+    Chunk (const Composition& composition, BlockPool* blockPool, ChangeVersion* changeVersion, const SharedComponentStore* sharedComponents, std::pmr::memory_resource* resource);
     ~Chunk ();
 
     uint32_t GetCount () const;
+    // When the chunk last became empty, only meaningful while GetCount() == 0
+    std::chrono::steady_clock::time_point GetEmptySince () const;
     const Composition& GetComposition () const;
     const ComponentFlags& GetComponentFlags () const;
 
+    uint32_t GetBlockCapacity () const;
+    uint32_t GetBlockCount () const;
+    uint32_t GetBlockEntityCount (uint32_t block) const;
+    // Slots past GetBlockEntityCount are valid scratch space only for trivially copyable components
+    uint32_t GetBlockPaddedEntityCount (uint32_t block) const;
+
     template<typename T>
     T* Find ();
     template<typename T>
     T* Find (uint32_t index);
 
+    // - nullptr if the chunk doesn't have the shared component
+    template<typename T>
+    const T* FindShared () const;
+
+    template<typename T>
+    void Fill (uint32_t first, uint32_t count, const T& value);
+
+    // - True if entities were added, removed, or moved, or any of the components
+    //   were written after the since version
+    bool HasChangedSince (const ComponentFlags& components, uint32_t since) const;
+    // - Records a write to a component's array, does nothing for components the chunk doesn't store
+    // - Takes a new version if none is given
+    void MarkChanged (ComponentIndex componentIndex);
+    void MarkChanged (ComponentIndex componentIndex, uint32_t version);
+
     uint32_t AllocateEntity ();
+    uint32_t AllocateEntities (uint32_t count);
     uint32_t CloneEntity (uint32_t index);
+    void CopyEntityTo (uint32_t index, Chunk& to, uint32_t toIndex, uint32_t count) const;
     uint32_t MoveTo (uint32_t from, Chunk& to);
+    uint32_t MoveAllTo (Chunk& to);
+    uint32_t MoveEntitiesTo (const uint32_t* indices, uint32_t count, Chunk& to);
     void RemoveEntity (uint32_t index);
+    void RemoveAllEntities ();
+
+    // Cached destination chunks for adding/removing sets of components
+    // - nullptr if the transition hasn't been cached yet
+    Chunk* FindAddTransition (const ComponentFlags& added) const;
+    Chunk* FindRemoveTransition (const ComponentFlags& removed) const;
+    void SetAddTransition (const ComponentFlags& added, Chunk* to);
+    void SetRemoveTransition (const ComponentFlags& removed, Chunk* to);
+    // Forgets every cached transition leading to chunks that are being destroyed
+    // - destroyed must be sorted
+    void RemoveTransitionsTo (const std::pmr::vector<Chunk*>& destroyed);
+
+private:
+    void AllocateBlock ();
+    void FreeBlock ();
+    void MarkStructuralChange ();
+
+    static size_t AlignArrayOffset (size_t offset, size_t alignment);
+    size_t GetBlockSize (uint32_t capacity) const;
 
 private: // Data
-    std::unordered_map<ComponentId, IComponentCollection*> m_componentArrays;
+    BlockPool* m_blockPool;
+    ChangeVersion* m_changeVersion;
+    std::pmr::memory_resource* m_resource;
+
+    // Every component array in the chunk
+    std::pmr::vector<IComponentCollection*> m_componentArrays;
+    // Indexed by ComponentIndex, nullptr for components the chunk doesn't have
+    std::pmr::vector<IComponentCollection*> m_componentLookup;
+
+    // Parallel to the composition's shared values
+    const void* m_sharedValues[ECS_MAX_SHARED_COMPONENTS] = {};
+
+    std::pmr::vector<byte_t*> m_blocks;
+    size_t m_blockAlignment = 0;
+    size_t m_blockSize = 0;
+    uint32_t m_blockCapacity = 0;
+
+    std::pmr::unordered_map<ComponentFlags, Chunk*> m_addTransitions;
+    std::pmr::unordered_map<ComponentFlags, Chunk*> m_removeTransitions;
 
     uint32_t m_count = 0;
+    // Only changed while the Manager holds its entity lock exclusively
+    uint32_t m_structuralVersion = 0;
+    std::chrono::steady_clock::time_point m_emptySince;
     Composition m_composition;
 };
 
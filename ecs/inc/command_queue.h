@@ -5,11 +5,17 @@
 
 #pragma once
 
+#include "../config.h"
 #include "entity.h"
 #include "component.h"
+#include "component_collection.h"
+#include "composition.h"
 #include "prefab.h"
+#include "helpers/memory.h"
 
 #include <cstdint>
+#include <memory_resource>
+#include <unordered_map>
 #include <vector>
 
 namespace ecs {
@@ -18,36 +24,37 @@ class Manager;
 
 namespace impl {
 
-struct IComponentRemover {
-    virtual void Apply (Entity entity, Manager* mgr) = 0;
+struct Chunk;
+struct CommandQueue;
+struct SharedComponentStore;
 
-    virtual ~IComponentRemover () {}
-};
-
-template<typename T>
-struct ComponentRemover : public IComponentRemover {
-    void Apply (Entity entity, Manager* mgr) override;
-
-    virtual ~ComponentRemover () {}
-};
-
-struct IQueuedComponentCollection {
-    virtual void Apply (Entity entity, uint32_t index, Manager* mgr) = 0;
-    virtual void Clear () = 0;
-
-    virtual ~IQueuedComponentCollection () {}
+// - How a queued component is added, removed, and moved, one table per component type
+struct CommandFunctions {
+    ComponentId componentId;
+    uint32_t size;
+    uint32_t alignment;
+
+    // Adds the component to a composition, interning the value of shared components
+    void (*addTo)(Composition& composition, SharedComponentStore& sharedComponents, const void* component);
+    void (*removeFrom)(Composition& composition);
+    // Writes the value to an entity, if its chunk stores the component
+    void (*setValue)(Chunk* chunk, uint32_t chunkIndex, const void* component);
+    // Move constructs a component into uninitialized memory
+    void (*moveConstruct)(void* to, void* from);
+    // nullptr for trivially destructible components
+    void (*destroy)(void* component);
 };
 
 template<typename T>
-struct QueuedComponentCollection : public IQueuedComponentCollection {
-    void Apply (Entity entity, uint32_t index, Manager* mgr) override;
-    void Clear () override;
-    uint32_t Push (T&& component);
-
-    virtual ~QueuedComponentCollection () {}
+struct QueuedComponent {
+    static const CommandFunctions* GetFunctions ();
 
 private:
-    std::vector<T> m_components;
+    static void AddTo (Composition& composition, SharedComponentStore& sharedComponents, const void* component);
+    static void RemoveFrom (Composition& composition);
+    static void SetValue (Chunk* chunk, uint32_t chunkIndex, const void* component);
+    static void MoveConstruct (void* to, void* from);
+    static void Destroy (void* component);
 };
 
 enum class ECommandType : uint8_t {
@@ -55,47 +62,159 @@ enum class ECommandType : uint8_t {
     CloneEntity,
     CreateEntity,
     DestroyEntity,
+    ReleaseEntities,
     RemoveComponent,
     SpawnPrefab,
 };
 
+// - Written into a CommandBlock, followed by its data
+//     - AddComponent is followed by the component
+//     - SpawnPrefab and ReleaseEntities are followed by an entity count and that many reserved entities
 struct Command {
+    // Component the command adds or removes, nullptr for other commands
+    const CommandFunctions* functions;
+    Entity entity;
+    // Entity reserved for the copy made by CloneEntity
+    Entity reserved;
+    // Bytes from the start of this command to the next one
+    uint32_t size;
+    // Bytes from the start of this command to its data
+    uint16_t dataOffset;
     ECommandType type;
+
+    void* GetData () const;
+};
+
+// - A piece of a CommandQueue's buffer, commands are written one after another after it
+struct CommandBlock {
+    CommandBlock* next;
+    uint32_t capacity;
+    uint32_t used;
+
+    byte_t* GetData ();
+};
+
+// - An entity that adds or removes were queued for
+// - Its changes are applied together, moving it once straight to the chunk it ends up in
+struct PendingEntity {
     Entity entity;
-    ComponentId componentId;
-    uint32_t addComponentIndex;
+    // Reserved by a queued CreateEntity, doesn't exist until the changes are applied
+    bool create = false;
+    // Destroyed before it was created, its reservation is released instead
+    bool destroyed = false;
+    // nullptr until the destination is known, and when the entity no longer exists
+    Chunk* from = nullptr;
+    Chunk* to = nullptr;
+};
+
+// - One queued add or remove, in the order they were queued
+struct PendingChange {
+    uint32_t pendingEntity;
+    const Command* command;
+};
+
+// - Pending entities moving between the same two chunks, moved or created together
+struct PendingBatch {
+    uint32_t first;
+    uint32_t count;
+};
+
+// - The commands queued while working on one item of an ordered list of work, see CommandQueue::BeginSegment
+// - Runs until the next segment starts
+struct CommandSegment {
+    uint32_t order;
+    // Index of its first command, and where in the buffer that command is or will be written
+    uint32_t first;
+    CommandBlock* block;
+    uint32_t offset;
+};
+
+// - A segment of one of the queues being merged by CommandQueue::MergeFrom
+struct MergeSegment {
+    uint32_t order;
+    uint32_t count;
+    CommandBlock* block;
+    uint32_t offset;
 };
 
 struct CommandQueue {
+    CommandQueue (std::pmr::memory_resource* resource = std::pmr::get_default_resource());
     ~CommandQueue ();
 
     bool IsEmpty () const;
 
     void Apply (Manager* mgr);
 
+    // - Exchanges queued commands with another queue using the same memory resource
+    void Swap (CommandQueue& other);
+
+    // - Commands queued from here on were queued while working on item order of some ordered list of work
+    void BeginSegment (uint32_t order);
+    // - Moves the commands of other queues to the end of this one, segments sorted by order
+    // - Segments with the same order keep the order of queues, commands queued
+    //   before a queue's first segment are treated as order 0
+    void MergeFrom (CommandQueue* const* queues, uint32_t count);
+
     void AddComponents (Entity) {}
     template<typename T, typename...Args>
     void AddComponents (Entity entity, T component, Args...args);
 
-    void CloneEntity (Entity entity);
+    void CloneEntity (Entity entity, Entity reserved);
 
     template<typename T, typename...Args>
-    void CreateEntity (T component, Args...args);
+    void CreateEntity (Entity reserved, T component, Args...args);
 
     void DestroyEntity (Entity entity);
 
+    // - Returns where to write count reserved entities that turned out not to be needed
+    Entity* ReleaseEntities (uint32_t count);
+
     template<typename...Args>
     typename std::enable_if<(sizeof...(Args) == 0)>::type RemoveComponents (Entity) {}
     template<typename T, typename...Args>
     void RemoveComponents (Entity entity);
 
-    void SpawnPrefab (Prefab prefab);
+    // - Returns where to write the count entities reserved for the spawned entities
+    Entity* SpawnPrefab (Prefab prefab, uint32_t count);
+
+private:
+    friend class ::ecs::Manager;
+    std::pmr::memory_resource* m_resource;
+
+    // Commands are written back to back into a list of blocks, which are kept
+    // when the queue is cleared and written over from the first one again
+    CommandBlock* m_firstBlock = nullptr;
+    CommandBlock* m_writeBlock = nullptr;
+    uint32_t m_commandCount = 0;
+    // Clearing only has to visit commands when a component needs destroying
+    bool m_hasDestructibleComponents = false;
+    std::pmr::vector<CommandSegment> m_segments;
+
+    // Only used during MergeFrom, kept to reuse its memory
+    std::pmr::vector<MergeSegment> m_mergeSegments;
+
+    // Only used during Apply, kept to reuse their memory
+    std::pmr::vector<PendingEntity> m_pendingEntities;
+    std::pmr::vector<PendingChange> m_pendingChanges;
+    std::pmr::unordered_map<EntityId, uint32_t> m_pendingLookup;
+    std::pmr::vector<uint32_t> m_pendingOrder;
+    std::pmr::vector<PendingBatch> m_pendingBatches;
+    std::pmr::vector<uint32_t> m_pendingChunkIndices;
 
 private:
-    friend class Manager;
-    std::vector<Command> m_commands;
-    std::unordered_map<ComponentId, IComponentRemover*> m_componentRemovers;
-    std::unordered_map<ComponentId, IQueuedComponentCollection*> m_queuedComponents;
+    // - Writes a command, returning where its data goes
+    void* PushCommand (ECommandType type, Entity entity, Entity reserved, const CommandFunctions* functions, uint32_t dataSize, uint32_t dataAlignment);
+    void NextWriteBlock (uint32_t size);
+    // - Reads the command at a position in the buffer, moving the position past it
+    static Command* ReadCommand (CommandBlock*& block, uint32_t& offset);
+
+    void Clear ();
+
+    uint32_t AddPendingEntity (Entity entity, bool create);
+    uint32_t FindOrAddPendingEntity (Entity entity);
+    void ApplyPendingChanges (Manager* mgr);
+    void ApplyPendingChangeTo (const PendingChange& change, Composition& composition, SharedComponentStore& sharedComponents) const;
+    void SetPendingValue (const PendingChange& change, Chunk* chunk, uint32_t chunkIndex) const;
 };
 
 } // namespace impl
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <cstdint>
+#include <type_traits>
 #include "helpers/hash.h"
 
 namespace ecs {
@@ -21,6 +22,17 @@ namespace ecs {
         return s_id;                                                                    \
     }
 
+// Use instead of ECS_COMPONENT for components whose value is shared by a whole chunk
+// - The value is stored once per chunk instead of once per entity, and entities
+//   with different values are kept in different chunks
+// - Must be trivially copyable, values are compared and hashed byte for byte,
+//   so avoid padding or zero it
+// - Read in jobs with ECS_READ_SHARED, or with Manager->FindSharedComponent<T>(entity)
+// - Adding one with a different value moves the entity to that value's chunk
+#define ECS_SHARED_COMPONENT(uniqueName)                                    \
+    ECS_COMPONENT(uniqueName)                                               \
+    static constexpr bool IsEcsSharedComponent () { return true; }
+
 // - Create a struct that inherits ecs::ISingletonComponent
 // - Guaranteed to exist
 // - One per Manager, use Manager->GetSingletonComponent<T>()
@@ -33,11 +45,22 @@ namespace impl {
 
 typedef uint64_t ComponentId;
 
+// Dense index assigned to each component type the first time it is used
+typedef uint32_t ComponentIndex;
+
 template<typename T>
 ComponentId GetComponentId ();
 
+template<typename T>
+ComponentIndex GetComponentIndex ();
+
 template<typename T>
 size_t GetComponentSize ();
 
+template<typename T, typename = void>
+struct IsSharedComponent : std::false_type {};
+template<typename T>
+struct IsSharedComponent<T, std::void_t<decltype(T::IsEcsSharedComponent())>> : std::true_type {};
+
 } // namespace impl
 } // namespace ecs
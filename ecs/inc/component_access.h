@@ -9,22 +9,47 @@
 
 namespace ecs {
 
+// Records an access on the job's compile-time signature, see job_signature.h
+#define ECS_JOB_ACCESS_LIST decltype(__ecsAccess(::ecs::impl::AccessCounter<::ecs::impl::MAX_JOB_ACCESS_COUNT>{}))
+#define ECS_JOB_ACCESS(accessType, componentType)                                                                              \
+static_assert(ECS_JOB_ACCESS_LIST::Count < ::ecs::impl::MAX_JOB_ACCESS_COUNT, "Too many READ/WRITE accessors on one job");   \
+static typename ::ecs::impl::AppendAccess<ECS_JOB_ACCESS_LIST, ::ecs::impl::accessType<componentType>>::type              \
+    __ecsAccess (::ecs::impl::AccessCounter<ECS_JOB_ACCESS_LIST::Count + 1>);                                                \
+friend struct ::ecs::impl::JobAccessor;
+
 // Component Access macros
+// - ECS_CHANGED also requires its components, and skips chunks where none of them
+//   have been written, nor entities added, removed, or moved, since the job last ran
+#define ECS_CHANGED(...) ::ecs::impl::Changed<__VA_ARGS__> ECS_TOKEN_COMBINE(__changed, __LINE__) = ::ecs::impl::Changed<__VA_ARGS__>(*this);
 #define ECS_EXCLUDE(...) ::ecs::impl::Exclude<__VA_ARGS__> ECS_TOKEN_COMBINE(__exclude, __LINE__) = ::ecs::impl::Exclude<__VA_ARGS__>(*this);
 
 #define ECS_READ(componentType, variableName)                                                                   \
 ::ecs::impl::Read<componentType> variableName = ::ecs::impl::Read<componentType>(*this);                        \
+ECS_JOB_ACCESS(ReadAccess, componentType)                                                                       \
 static_assert(!std::is_empty<componentType>(), "Cannot read access an empty/tag component, use ECS_REQUIRE");   \
-static_assert(!std::is_base_of<::ecs::ISingletonComponent, componentType>::value, "Use ECS_READ_SINGLETON");
+static_assert(!std::is_base_of<::ecs::ISingletonComponent, componentType>::value, "Use ECS_READ_SINGLETON");   \
+static_assert(!::ecs::impl::IsSharedComponent<componentType>::value, "Use ECS_READ_SHARED");
+
+#define ECS_READ_CHANGED(componentType, variableName)   \
+ECS_READ(componentType, variableName)                   \
+ECS_CHANGED(componentType)
 
 #define ECS_READ_OTHER(componentType, variableName)                                                                                     \
 ::ecs::impl::ReadOther<componentType> variableName = ::ecs::impl::ReadOther<componentType>(*this);                                      \
+ECS_JOB_ACCESS(ReadAccess, componentType)                                                                                               \
 static_assert(!std::is_empty<componentType>(), "Cannot read access an empty/tag component, use HasComponent<T>(entity)");               \
 static_assert(!std::is_same<std::remove_const<componentType>::type, ::ecs::Entity>::value, "ReadOther Entity doesn't even make sense"); \
 static_assert(!std::is_base_of<::ecs::ISingletonComponent, componentType>::value, "Use ECS_READ_SINGLETON");
 
+// - Reads the chunk's single value of a shared component, the same for every entity in ForEachChunk
+#define ECS_READ_SHARED(componentType, variableName)                                                        \
+::ecs::impl::ReadShared<componentType> variableName = ::ecs::impl::ReadShared<componentType>(*this);        \
+ECS_JOB_ACCESS(ReadAccess, componentType)                                                                   \
+static_assert(::ecs::impl::IsSharedComponent<componentType>::value, "Must use ECS_SHARED_COMPONENT to be read in this way");
+
 #define ECS_READ_SINGLETON(componentType, variableName)                                                     \
 ::ecs::impl::ReadSingleton<componentType> variableName = ::ecs::impl::ReadSingleton<componentType>(*this);  \
+ECS_JOB_ACCESS(ReadAccess, componentType)                                                                   \
 static_assert(std::is_base_of<::ecs::ISingletonComponent, componentType>::value, "Must inherit ISingletonComponent to be read in this way");
 
 #define ECS_REQUIRE(...) ::ecs::impl::Require<__VA_ARGS__> ECS_TOKEN_COMBINE(__require, __LINE__) = ::ecs::impl::Require<__VA_ARGS__>(*this);
@@ -32,18 +57,23 @@ static_assert(std::is_base_of<::ecs::ISingletonComponent, componentType>::value,
 
 #define ECS_WRITE(componentType, variableName)                                                                                                  \
 ::ecs::impl::Write<componentType> variableName = ::ecs::impl::Write<componentType>(*this);                                                      \
+ECS_JOB_ACCESS(WriteAccess, componentType)                                                                                                      \
 static_assert(!std::is_empty<componentType>(), "Cannot write access an empty/tag component, use ECS_REQUIRE");                                  \
 static_assert(!std::is_same<std::remove_const<componentType>::type, ::ecs::Entity>::value, "Don't write to Entity, you will break everything"); \
-static_assert(!std::is_base_of<::ecs::ISingletonComponent, componentType>::value, "Use ECS_WRITE_SINGLETON");
+static_assert(!std::is_base_of<::ecs::ISingletonComponent, componentType>::value, "Use ECS_WRITE_SINGLETON");                                   \
+static_assert(!::ecs::impl::IsSharedComponent<componentType>::value, "Shared components can't be written, use AddComponents to change an entity's value");
 
 #define ECS_WRITE_OTHER(componentType, variableName)                                                                                            \
 ::ecs::impl::WriteOther<componentType> variableName = ::ecs::impl::WriteOther<componentType>(*this);                                            \
+ECS_JOB_ACCESS(WriteAccess, componentType)                                                                                                      \
 static_assert(!std::is_empty<componentType>(), "Cannot write access an empty/tag component, use HasComponent<T>(entity)");                      \
 static_assert(!std::is_same<std::remove_const<componentType>::type, ::ecs::Entity>::value, "Don't write to Entity, you will break everything"); \
-static_assert(!std::is_base_of<::ecs::ISingletonComponent, componentType>::value, "Use ECS_WRITE_SINGLETON");
+static_assert(!std::is_base_of<::ecs::ISingletonComponent, componentType>::value, "Use ECS_WRITE_SINGLETON");                                   \
+static_assert(!::ecs::impl::IsSharedComponent<componentType>::value, "Shared components can't be written, use AddComponents to change an entity's value");
 
 #define ECS_WRITE_SINGLETON(componentType, variableName)                                                        \
 ::ecs::impl::WriteSingleton<componentType> variableName = ::ecs::impl::WriteSingleton<componentType>(*this);    \
+ECS_JOB_ACCESS(WriteAccess, componentType)                                                                      \
 static_assert(std::is_base_of<::ecs::ISingletonComponent, componentType>::value, "Must inherit ISingletonComponent to be written in this way");
 
 } // namespace ecs
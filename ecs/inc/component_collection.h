@@ -6,43 +6,91 @@
 #pragma once
 
 #include "component.h"
+#include "helpers/memory.h"
 
+#include <atomic>
+#include <cstdint>
+#include <memory_resource>
 #include <vector>
 
 namespace ecs {
 namespace impl {
 
+typedef uint8_t byte_t;
+
+// - A single component's array within each of a chunk's blocks
+// - Does not own any memory, the chunk assigns it a layout within its blocks
+// - Trivially copyable components are never constructed or destroyed, the chunk
+//   moves them as raw bytes instead of going through the virtual interface
 struct IComponentCollection {
+    IComponentCollection (ComponentIndex componentIndex, bool triviallyCopyable);
     virtual ~IComponentCollection () {}
 
     template<typename T>
     T* Get (uint32_t index);
 
-    virtual uint32_t Allocate () = 0;
+    ComponentIndex GetComponentIndex () const;
+
+    // Version of the last job run or Manager call that wrote this array, see ChangeVersion
+    uint32_t GetChangeVersion () const;
+    void SetChangeVersion (uint32_t version);
+
+    // Number of entities from index to the end of its block
+    uint32_t GetContiguousCount (uint32_t index) const;
+
+    bool IsTriviallyCopyable () const;
+    // Copies raw component bytes, only valid for trivially copyable components
+    void CopyBytesTo (uint32_t fromIndex, IComponentCollection& to, uint32_t toIndex, uint32_t count) const;
+    // Copies one component's raw bytes into count entities, only valid for trivially copyable components
+    void FillBytesTo (uint32_t fromIndex, IComponentCollection& to, uint32_t toIndex, uint32_t count) const;
+
+    void SetLayout (const std::pmr::vector<byte_t*>* blocks, uint32_t blockCapacity, size_t blockOffset);
+
+    virtual size_t GetAlignment () const = 0;
+    virtual size_t GetSize () const = 0;
+
+    virtual void Allocate (uint32_t first, uint32_t count) = 0;
     virtual void CopyTo (uint32_t from, uint32_t to) = 0;
-    virtual void MoveTo (uint32_t fromIndex, IComponentCollection& to, uint32_t toIndex) = 0;
-    virtual void Remove (uint32_t index) = 0;
-    virtual void RemoveAll () = 0;
+    virtual void FillTo (uint32_t fromIndex, IComponentCollection& to, uint32_t toIndex, uint32_t count) = 0;
+    virtual void MoveTo (uint32_t fromIndex, IComponentCollection& to, uint32_t toIndex, uint32_t count) = 0;
+    virtual void Remove (uint32_t index, uint32_t lastIndex) = 0;
+    virtual void RemoveAll (uint32_t count) = 0;
+
+    // Destroys the collection, returning its memory to the resource it was allocated from
+    virtual void Free (std::pmr::memory_resource* resource) = 0;
 
 protected:
-    virtual void* GetComponentAtIndex (uint32_t index) = 0;
-    virtual ComponentId GetComponentId () const = 0;
+    void* GetComponentAtIndex (uint32_t index) const;
+
+private:
+    const std::pmr::vector<byte_t*>* m_blocks = nullptr;
+    uint32_t m_blockCapacity = 0;
+    size_t m_blockOffset = 0;
+    size_t m_componentSize = 0;
+    // Written by every worker of a parallel job at once
+    std::atomic<uint32_t> m_changeVersion{ 0 };
+    ComponentIndex m_componentIndex;
+    bool m_triviallyCopyable;
 };
 
 template<typename T>
 struct TComponentCollection : IComponentCollection {
-    uint32_t Allocate () override;
+    TComponentCollection ();
+
+    size_t GetAlignment () const override;
+    size_t GetSize () const override;
+
+    void Allocate (uint32_t first, uint32_t count) override;
     void CopyTo (uint32_t from, uint32_t to) override;
-    void MoveTo (uint32_t fromIndex, IComponentCollection& to, uint32_t toIndex) override;
-    void Remove (uint32_t index) override;
-    void RemoveAll () override;
+    void FillTo (uint32_t fromIndex, IComponentCollection& to, uint32_t toIndex, uint32_t count) override;
+    void MoveTo (uint32_t fromIndex, IComponentCollection& to, uint32_t toIndex, uint32_t count) override;
+    void Remove (uint32_t index, uint32_t lastIndex) override;
+    void RemoveAll (uint32_t count) override;
 
-protected:
-    void* GetComponentAtIndex (uint32_t index) override;
-    ComponentId GetComponentId () const override;
+    void Free (std::pmr::memory_resource* resource) override;
 
 private:
-    std::vector<T> m_components;
+    T* At (uint32_t index);
 };
 
 } // namespace impl
@@ -5,30 +5,47 @@
 
 #pragma once
 
+#include "../config.h"
 #include "component.h"
 
 #include <cstdint>
 #include <functional>
-#include <unordered_set>
 
 namespace ecs {
 namespace impl {
 
-using ComponentFlagIterator = std::unordered_set<ComponentId>::const_iterator;
+struct ComponentFlags;
 
+// - Iterates the ComponentIndex of each set flag in ascending order
+struct ComponentFlagIterator {
+    ComponentFlagIterator (const ComponentFlags& flags, ComponentIndex index);
+
+    ComponentIndex operator* () const;
+    ComponentFlagIterator& operator++ ();
+    bool operator!= (const ComponentFlagIterator& rhs) const;
+
+private:
+    const ComponentFlags& m_flags;
+    ComponentIndex m_index;
+
+    void SkipUnset ();
+};
+
+// - A fixed-size bitset with one bit per ComponentIndex
+// - Copies and comparisons never allocate
 struct ComponentFlags {
     ComponentFlags ();
 
     void Clear ();
 
-    void ClearFlag (ComponentId id);
+    void ClearFlag (ComponentIndex index);
     template<typename...Args>
     typename std::enable_if<(sizeof...(Args) == 0)>::type ClearFlags () {};
     template<typename T, typename...Args>
     void ClearFlags ();
     void ClearFlags (const ComponentFlags& flags);
 
-    void SetFlag (ComponentId id);
+    void SetFlag (ComponentIndex index);
     template<typename...Args>
     typename std::enable_if<(sizeof...(Args) == 0)>::type SetFlags () {};
     template<typename T, typename...Args>
@@ -42,17 +59,28 @@ struct ComponentFlags {
     bool HasAny (const ComponentFlags& rhs) const;
     bool HasNone (const ComponentFlags& rhs) const;
 
-    bool Has (ComponentId id) const;
+    bool Has (ComponentIndex index) const;
     template<typename T>
-    bool Has () const { return Has(GetComponentId<T>()); }
+    bool Has () const { return Has(GetComponentIndex<T>()); }
+
+    bool IsEmpty () const;
 
     size_t GetHash () const;
     bool operator== (const ComponentFlags& rhs) const;
 
 private:
-    std::unordered_set<ComponentId> m_flags;
+    static constexpr uint32_t BITS_PER_WORD = 64;
+    static constexpr uint32_t WORD_COUNT = (ECS_MAX_COMPONENT_TYPES + BITS_PER_WORD - 1) / BITS_PER_WORD;
+
+    uint64_t m_words[WORD_COUNT];
+
+    friend struct ComponentFlagIterator;
 };
 
+// - Flags for a fixed list of component types, built once per list
+template<typename T, typename...Args>
+const ComponentFlags& StaticComponentFlags ();
+
 } // namespace impl
 } // namespace ecs
 
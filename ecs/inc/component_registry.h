@@ -0,0 +1,41 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "../config.h"
+#include "component.h"
+#include "component_collection.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory_resource>
+
+namespace ecs {
+namespace impl {
+
+typedef IComponentCollection* (*ComponentCollectionAllocateFunc)(std::pmr::memory_resource*);
+
+struct ComponentInfo {
+    ComponentId id = 0;
+    // nullptr for components that are never stored in chunks (tags, singletons, and shared components)
+    ComponentCollectionAllocateFunc allocateCollection = nullptr;
+};
+
+// - Hands out dense ComponentIndex values to component types as they are first used
+// - Shared by every Manager, a component has the same index in all of them
+struct ComponentRegistry {
+    template<typename T>
+    static ComponentIndex RegisterComponent ();
+
+    static const ComponentInfo& GetInfo (ComponentIndex index);
+
+private:
+    static ComponentInfo* GetInfos ();
+    static std::atomic<ComponentIndex>& GetCounter ();
+};
+
+} // namespace impl
+} // namespace ecs
@@ -5,20 +5,28 @@
 
 #pragma once
 
+#include "../config.h"
 #include "component_flags.h"
-#include "component_collection.h"
-
-#include <unordered_map>
 
 namespace ecs {
 namespace impl {
 
-typedef IComponentCollection* (*ComponentCollectionAllocateFunc)();
-typedef std::unordered_map<ComponentId, ComponentCollectionAllocateFunc> ComponentCollectionFactory;
+// Interned value of one of a composition's shared components, see SharedComponentStore
+struct SharedValue {
+    ComponentIndex componentIndex = 0;
+    uint32_t valueId = 0;
+};
 
+// - The set of components that make up a chunk, plus the values of its shared components
+// - Trivially copyable, the ComponentRegistry knows how to build each component's storage
 struct Composition {
     const ComponentFlags& GetComponentFlags () const;
-    const ComponentCollectionFactory& GetComponentCollectionFactory () const;
+
+    // - Ordered by component index
+    uint32_t GetSharedValueCount () const;
+    const SharedValue& GetSharedValue (uint32_t index) const;
+    // - Replaces the value if the component already has one
+    void SetSharedValue (ComponentIndex componentIndex, uint32_t valueId);
 
     size_t GetHash () const;
     bool operator== (const Composition& rhs) const;
@@ -35,9 +43,12 @@ struct Composition {
 
 private:
     ComponentFlags m_flags;
-    ComponentCollectionFactory m_componentCollectionFactory;
+    // Unused entries stay zeroed so they compare equal
+    SharedValue m_sharedValues[ECS_MAX_SHARED_COMPONENTS];
+    uint32_t m_sharedValueCount = 0;
 
 private:
+    void RemoveClearedSharedValues ();
     void SetComponentsInternal ();
     template<typename T, typename...Args>
     void SetComponentsInternal (T component, Args...args);
@@ -0,0 +1,65 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "component_flags.h"
+#include "prefab.h"
+
+#include <vector>
+
+namespace ecs {
+
+class Manager;
+struct Job;
+
+namespace impl {
+struct QueryCache;
+} // namespace impl
+
+// - Selects entities by the components they have, using the same rules as
+//   a job's ECS_REQUIRE, ECS_EXCLUDE and ECS_REQUIRE_ANY
+// - Prefab entities never match
+// - Used with the Manager's batch operations:
+//     mgr.DestroyImmediate(ecs::Filter().Require<Projectile>());
+struct Filter {
+    Filter ();
+
+    template<typename T, typename...Args>
+    Filter& Exclude ();
+    template<typename T, typename...Args>
+    Filter& Require ();
+    template<typename T, typename...Args>
+    Filter& RequireAny ();
+
+    bool Matches (const impl::ComponentFlags& flags) const;
+
+    size_t GetHash () const;
+    bool operator== (const Filter& rhs) const;
+
+private:
+    // - The hash and equality of this filter with required in place of its required components
+    size_t GetHash (const impl::ComponentFlags& required) const;
+    bool Equals (const Filter& rhs, const impl::ComponentFlags& required) const;
+
+private:
+    impl::ComponentFlags m_exclude;
+    impl::ComponentFlags m_required;
+    std::vector<impl::ComponentFlags> m_requireAny;
+
+    friend class Manager;
+    friend struct Job;
+    friend struct impl::QueryCache;
+};
+
+} // namespace ecs
+
+namespace std {
+    template <> struct hash<::ecs::Filter> {
+        size_t operator() (const ::ecs::Filter& filter) const {
+            return filter.GetHash();
+        }
+    };
+};
@@ -0,0 +1,29 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ecs {
+namespace impl {
+
+// Index of the lowest set bit, value must not be 0
+inline uint32_t CountTrailingZeros (uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return (uint32_t)index;
+#else
+    return (uint32_t)__builtin_ctzll(value);
+#endif
+}
+
+} // namespace impl
+} // namespace ecs
@@ -20,5 +20,14 @@ inline uint64_t StringHash (const char* str)
   return hash;
 }
 
+// djb2 over raw bytes, continuing from hash
+inline uint64_t BytesHash (const void* data, size_t size, uint64_t hash = 5381)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; ++i)
+    hash = ((hash << 5) + hash) ^ bytes[i];
+  return hash;
+}
+
 } // namespace impl
 } // namespace ecs
@@ -0,0 +1,42 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+namespace ecs {
+namespace impl {
+
+// - Constructs an object in memory allocated from a memory resource
+template<typename T, typename...Args>
+inline T* NewObject (std::pmr::memory_resource* resource, Args&&...args) {
+    void* memory = resource->allocate(sizeof(T), alignof(T));
+    return new (memory) T(std::forward<Args>(args)...);
+}
+
+// - Destroys an object created by NewObject and returns its memory
+// - T must be the type the object was created as, not a base class
+template<typename T>
+inline void DeleteObject (std::pmr::memory_resource* resource, T* object) {
+    if (!object)
+        return;
+    object->~T();
+    resource->deallocate(object, sizeof(T), alignof(T));
+}
+
+// - Destroys and rebuilds an object in place
+// - Used to give members a memory resource when their owner was
+//   constructed before the resource was known
+template<typename T, typename...Args>
+inline void Reconstruct (T& object, Args&&...args) {
+    object.~T();
+    new (&object) T(std::forward<Args>(args)...);
+}
+
+} // namespace impl
+} // namespace ecs
@@ -0,0 +1,50 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+
+namespace ecs {
+namespace impl {
+
+constexpr size_t POOLED_BLOCK_ALIGNMENT = alignof(std::max_align_t) > ECS_CHUNK_ARRAY_ALIGNMENT ? alignof(std::max_align_t) : ECS_CHUNK_ARRAY_ALIGNMENT;
+
+inline BlockPool::BlockPool (std::pmr::memory_resource* resource)
+    : m_resource(resource)
+    , m_freeBlocks(resource)
+{
+}
+
+inline BlockPool::~BlockPool () {
+    for (byte_t* block : m_freeBlocks)
+        m_resource->deallocate(block, ECS_CHUNK_BLOCK_SIZE, POOLED_BLOCK_ALIGNMENT);
+    m_freeBlocks.clear();
+}
+
+inline byte_t* BlockPool::Allocate (size_t size, size_t alignment) {
+    if (!IsPooled(size, alignment))
+        return static_cast<byte_t*>(m_resource->allocate(size, alignment));
+
+    if (m_freeBlocks.empty())
+        return static_cast<byte_t*>(m_resource->allocate(ECS_CHUNK_BLOCK_SIZE, POOLED_BLOCK_ALIGNMENT));
+
+    byte_t* block = m_freeBlocks.back();
+    m_freeBlocks.pop_back();
+    return block;
+}
+
+inline void BlockPool::Free (byte_t* block, size_t size, size_t alignment) {
+    if (!IsPooled(size, alignment)) {
+        m_resource->deallocate(block, size, alignment);
+        return;
+    }
+    m_freeBlocks.push_back(block);
+}
+
+inline bool BlockPool::IsPooled (size_t size, size_t alignment) {
+    return size <= ECS_CHUNK_BLOCK_SIZE && alignment <= POOLED_BLOCK_ALIGNMENT;
+}
+
+} // namespace impl
+} // namespace ecs
@@ -0,0 +1,18 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+namespace ecs {
+namespace impl {
+
+inline uint32_t ChangeVersion::Next () {
+    return m_value.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+inline bool IsNewerVersion (uint32_t version, uint32_t since) {
+    return (int32_t)(version - since) > 0;
+}
+
+} // namespace impl
+} // namespace ecs
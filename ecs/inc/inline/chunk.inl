@@ -5,6 +5,9 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
 
 namespace ecs {
 namespace impl {
@@ -18,48 +21,252 @@ template<typename T>
 inline T* Chunk::Find (uint32_t index) {
     static_assert(!std::is_empty<T>(), "Tag components don't actually exist, cannot return pointer to one");
 
-    if (index >= m_count)
+    const ComponentIndex componentIndex = GetComponentIndex<T>();
+    if (index >= m_count || componentIndex >= m_componentLookup.size())
         return nullptr;
 
-    auto iter = m_componentArrays.find(GetComponentId<T>());
-    if (iter == m_componentArrays.end())
+    IComponentCollection* collection = m_componentLookup[componentIndex];
+    if (!collection)
         return nullptr;
-    return iter->second->Get<T>(index);
+    return collection->template Get<T>(index);
 }
 
-inline Chunk::Chunk (const Composition& composition)
-    : m_composition(composition)
+template<typename T>
+inline const T* Chunk::FindShared () const {
+    static_assert(IsSharedComponent<T>::value, "Only components declared with ECS_SHARED_COMPONENT are shared");
+
+    const ComponentIndex componentIndex = GetComponentIndex<T>();
+    for (uint32_t i = 0; i < m_composition.GetSharedValueCount(); ++i) {
+        if (m_composition.GetSharedValue(i).componentIndex == componentIndex)
+            return static_cast<const T*>(m_sharedValues[i]);
+    }
+    return nullptr;
+}
+
+// - Sets a component on a contiguous range of entities, one block at a time
+template<typename T>
+inline void Chunk::Fill (uint32_t first, uint32_t count, const T& value) {
+    assert(first + count <= m_count);
+
+    const uint32_t end = first + count;
+    while (first < end) {
+        const uint32_t blockEnd = std::min((first / m_blockCapacity + 1) * m_blockCapacity, end);
+        T* array = Find<T>(first);
+        assert(array);
+        std::fill_n(array, blockEnd - first, value);
+        first = blockEnd;
+    }
+    MarkChanged(GetComponentIndex<T>());
+}
+
+inline Chunk::Chunk (const Composition& composition, BlockPool* blockPool, ChangeVersion* changeVersion, const SharedComponentStore* sharedComponents, std::pmr::memory_resource* resource)
+    : m_blockPool(blockPool)
+    , m_changeVersion(changeVersion)
+    , m_resource(resource)
+    , m_componentArrays(resource)
+    , m_componentLookup(resource)
+    , m_blocks(resource)
+    , m_addTransitions(resource)
+    , m_removeTransitions(resource)
+    , m_emptySince(std::chrono::steady_clock::now())
+    , m_composition(composition)
 {
-    for (const auto& factoryIter : m_composition.GetComponentCollectionFactory())
-        m_componentArrays.emplace(factoryIter.first, factoryIter.second());
+    for (ComponentIndex componentIndex : m_composition.GetComponentFlags()) {
+        const ComponentInfo& info = ComponentRegistry::GetInfo(componentIndex);
+        if (!info.allocateCollection)
+            continue;
+        IComponentCollection* collection = info.allocateCollection(m_resource);
+        m_componentArrays.push_back(collection);
+
+        if (m_componentLookup.size() <= componentIndex)
+            m_componentLookup.resize(componentIndex + 1, nullptr);
+        m_componentLookup[componentIndex] = collection;
+    }
+
+    for (uint32_t i = 0; i < m_composition.GetSharedValueCount(); ++i)
+        m_sharedValues[i] = sharedComponents->Get(m_composition.GetSharedValue(i).valueId);
+
+    // Ordering arrays by descending alignment means that every array
+    // starts aligned without needing any padding between them
+    std::sort(m_componentArrays.begin(), m_componentArrays.end(), [](IComponentCollection* lhs, IComponentCollection* rhs) {
+        return lhs->GetAlignment() > rhs->GetAlignment();
+    });
+
+    size_t entitySize = 0;
+    m_blockAlignment = std::max<size_t>(alignof(std::max_align_t), ECS_CHUNK_ARRAY_ALIGNMENT);
+    for (auto collection : m_componentArrays) {
+        entitySize += collection->GetSize();
+        m_blockAlignment = std::max(m_blockAlignment, collection->GetAlignment());
+    }
+
+    // Capacity is a whole number of lanes so that padded counts never run past an array
+    const size_t laneCount = ECS_CHUNK_LANE_COUNT;
+    const size_t entityCapacity = entitySize > 0 ? ECS_CHUNK_BLOCK_SIZE / entitySize : ECS_CHUNK_BLOCK_SIZE;
+    m_blockCapacity = (uint32_t)std::max(entityCapacity / laneCount * laneCount, laneCount);
+
+    // Every array starts on its own aligned boundary, give up a lane at a time
+    // if that padding pushed the block past the pooled block size
+    while (GetBlockSize(m_blockCapacity) > ECS_CHUNK_BLOCK_SIZE && m_blockCapacity > laneCount)
+        m_blockCapacity -= (uint32_t)laneCount;
+    m_blockSize = std::max<size_t>(GetBlockSize(m_blockCapacity), 1);
+
+    size_t blockOffset = 0;
+    for (auto collection : m_componentArrays) {
+        blockOffset = AlignArrayOffset(blockOffset, collection->GetAlignment());
+        collection->SetLayout(&m_blocks, m_blockCapacity, blockOffset);
+        blockOffset += collection->GetSize() * m_blockCapacity;
+    }
+}
+
+inline size_t Chunk::AlignArrayOffset (size_t offset, size_t alignment) {
+    alignment = std::max<size_t>(alignment, ECS_CHUNK_ARRAY_ALIGNMENT);
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+inline size_t Chunk::GetBlockSize (uint32_t capacity) const {
+    size_t blockOffset = 0;
+    for (auto collection : m_componentArrays)
+        blockOffset = AlignArrayOffset(blockOffset, collection->GetAlignment()) + collection->GetSize() * capacity;
+    return blockOffset;
 }
 
 inline Chunk::~Chunk () {
+    for (auto compArray : m_componentArrays) {
+        if (!compArray->IsTriviallyCopyable())
+            compArray->RemoveAll(m_count);
+        compArray->Free(m_resource);
+    }
+    m_componentArrays.clear();
+    m_componentLookup.clear();
     m_count = 0;
 
-    for (auto& compArray : m_componentArrays)
-        delete compArray.second;
-    m_componentArrays.clear();
+    while (!m_blocks.empty())
+        FreeBlock();
+}
+
+// - Blocks start zeroed so padding past the last entity holds valid trivially copyable values
+inline void Chunk::AllocateBlock () {
+    byte_t* block = m_blockPool->Allocate(m_blockSize, m_blockAlignment);
+    std::memset(block, 0, m_blockSize);
+    m_blocks.push_back(block);
 }
 
 inline uint32_t Chunk::AllocateEntity () {
-    for (auto& compArray : m_componentArrays)
-        compArray.second->Allocate();
-    return m_count++;
+    return AllocateEntities(1);
+}
+
+// - Adds count entities at the end of the chunk
+// - Components that aren't trivially copyable are default constructed, the rest
+//   are left uninitialized and must be written by the caller
+// - Returns the index of the first one, the rest follow it
+inline uint32_t Chunk::AllocateEntities (uint32_t count) {
+    while (m_count + count > m_blocks.size() * m_blockCapacity)
+        AllocateBlock();
+
+    for (auto compArray : m_componentArrays) {
+        if (!compArray->IsTriviallyCopyable())
+            compArray->Allocate(m_count, count);
+    }
+
+    const uint32_t first = m_count;
+    m_count += count;
+    MarkStructuralChange();
+    return first;
 }
 
 inline uint32_t Chunk::CloneEntity (uint32_t index) {
     assert(index < m_count);
     uint32_t newIndex = AllocateEntity();
 
-    for (auto& compIter : m_componentArrays) {
-        IComponentCollection* compCollection = compIter.second;
-        compCollection->CopyTo(index, newIndex);
+    for (auto compArray : m_componentArrays) {
+        if (compArray->IsTriviallyCopyable())
+            compArray->CopyBytesTo(index, *compArray, newIndex, 1);
+        else
+            compArray->CopyTo(index, newIndex);
     }
 
     return newIndex;
 }
 
+// - Copies the entity at index over count entities of another chunk, starting at toIndex
+// - Only components both chunks have are copied, and never the Entity component,
+//   the entities being written to keep their own handles
+inline void Chunk::CopyEntityTo (uint32_t index, Chunk& to, uint32_t toIndex, uint32_t count) const {
+    assert(index < m_count && toIndex + count <= to.m_count);
+
+    for (auto fromCollection : m_componentArrays) {
+        const ComponentIndex componentIndex = fromCollection->GetComponentIndex();
+        if (componentIndex >= to.m_componentLookup.size() || componentIndex == GetComponentIndex<Entity>())
+            continue;
+        IComponentCollection* toCollection = to.m_componentLookup[componentIndex];
+        if (!toCollection)
+            continue;
+        if (fromCollection->IsTriviallyCopyable())
+            fromCollection->FillBytesTo(index, *toCollection, toIndex, count);
+        else
+            fromCollection->FillTo(index, *toCollection, toIndex, count);
+    }
+}
+
+inline Chunk* Chunk::FindAddTransition (const ComponentFlags& added) const {
+    auto iter = m_addTransitions.find(added);
+    return iter != m_addTransitions.end() ? iter->second : nullptr;
+}
+
+inline Chunk* Chunk::FindRemoveTransition (const ComponentFlags& removed) const {
+    auto iter = m_removeTransitions.find(removed);
+    return iter != m_removeTransitions.end() ? iter->second : nullptr;
+}
+
+inline void Chunk::FreeBlock () {
+    m_blockPool->Free(m_blocks.back(), m_blockSize, m_blockAlignment);
+    m_blocks.pop_back();
+}
+
+inline uint32_t Chunk::GetBlockCapacity () const {
+    return m_blockCapacity;
+}
+
+inline uint32_t Chunk::GetBlockCount () const {
+    return (m_count + m_blockCapacity - 1) / m_blockCapacity;
+}
+
+inline uint32_t Chunk::GetBlockEntityCount (uint32_t block) const {
+    assert(block < GetBlockCount());
+    return std::min(m_count - block * m_blockCapacity, m_blockCapacity);
+}
+
+inline uint32_t Chunk::GetBlockPaddedEntityCount (uint32_t block) const {
+    const uint32_t laneCount = ECS_CHUNK_LANE_COUNT;
+    return (GetBlockEntityCount(block) + laneCount - 1) / laneCount * laneCount;
+}
+
+inline bool Chunk::HasChangedSince (const ComponentFlags& components, uint32_t since) const {
+    if (IsNewerVersion(m_structuralVersion, since))
+        return true;
+    for (ComponentIndex componentIndex : components) {
+        if (componentIndex >= m_componentLookup.size())
+            break;
+        const IComponentCollection* collection = m_componentLookup[componentIndex];
+        if (collection && IsNewerVersion(collection->GetChangeVersion(), since))
+            return true;
+    }
+    return false;
+}
+
+inline void Chunk::MarkChanged (ComponentIndex componentIndex) {
+    MarkChanged(componentIndex, m_changeVersion->Next());
+}
+
+inline void Chunk::MarkChanged (ComponentIndex componentIndex, uint32_t version) {
+    if (componentIndex < m_componentLookup.size() && m_componentLookup[componentIndex])
+        m_componentLookup[componentIndex]->SetChangeVersion(version);
+}
+
+inline void Chunk::MarkStructuralChange () {
+    m_structuralVersion = m_changeVersion->Next();
+}
+
 inline const Composition& Chunk::GetComposition () const {
     return m_composition;
 }
@@ -72,6 +279,10 @@ inline uint32_t Chunk::GetCount () const {
     return m_count;
 }
 
+inline std::chrono::steady_clock::time_point Chunk::GetEmptySince () const {
+    return m_emptySince;
+}
+
 inline uint32_t Chunk::MoveTo (uint32_t from, Chunk& to) {
     assert(from < m_count);
 
@@ -79,13 +290,17 @@ inline uint32_t Chunk::MoveTo (uint32_t from, Chunk& to) {
     auto newIndex = to.AllocateEntity();
 
     // Copy all our data over
-    for (auto& compIter : m_componentArrays) {
-        auto newCompArray = to.m_componentArrays.find(compIter.first);
-        if (newCompArray == to.m_componentArrays.end())
+    for (auto fromCollection : m_componentArrays) {
+        const ComponentIndex componentIndex = fromCollection->GetComponentIndex();
+        if (componentIndex >= to.m_componentLookup.size())
             continue;
-        IComponentCollection* fromCollection = compIter.second;
-        IComponentCollection* toCollection = newCompArray->second;
-        fromCollection->MoveTo(from, *toCollection, newIndex);
+        IComponentCollection* toCollection = to.m_componentLookup[componentIndex];
+        if (!toCollection)
+            continue;
+        if (fromCollection->IsTriviallyCopyable())
+            fromCollection->CopyBytesTo(from, *toCollection, newIndex, 1);
+        else
+            fromCollection->MoveTo(from, *toCollection, newIndex, 1);
     }
 
     // Remove from this chunk
@@ -95,15 +310,110 @@ inline uint32_t Chunk::MoveTo (uint32_t from, Chunk& to) {
     return newIndex;
 }
 
+// - Moves every entity in this chunk to the end of another chunk, preserving order
+// - Returns the new chunk index of the first entity moved
+inline uint32_t Chunk::MoveAllTo (Chunk& to) {
+    const uint32_t count = m_count;
+    const uint32_t first = to.AllocateEntities(count);
+
+    for (auto fromCollection : m_componentArrays) {
+        const ComponentIndex componentIndex = fromCollection->GetComponentIndex();
+        if (componentIndex >= to.m_componentLookup.size())
+            continue;
+        IComponentCollection* toCollection = to.m_componentLookup[componentIndex];
+        if (!toCollection)
+            continue;
+        if (fromCollection->IsTriviallyCopyable())
+            fromCollection->CopyBytesTo(0, *toCollection, first, count);
+        else
+            fromCollection->MoveTo(0, *toCollection, first, count);
+    }
+
+    RemoveAllEntities();
+
+    return first;
+}
+
+// - Moves the entities at indices to the end of another chunk, in the order given
+// - indices must be sorted from highest to lowest, so the entities swapped into
+//   removed slots are never ones that are still waiting to be moved
+// - Returns the new chunk index of the first entity moved
+inline uint32_t Chunk::MoveEntitiesTo (const uint32_t* indices, uint32_t count, Chunk& to) {
+    const uint32_t first = to.AllocateEntities(count);
+
+    for (auto fromCollection : m_componentArrays) {
+        const ComponentIndex componentIndex = fromCollection->GetComponentIndex();
+        if (componentIndex >= to.m_componentLookup.size())
+            continue;
+        IComponentCollection* toCollection = to.m_componentLookup[componentIndex];
+        if (!toCollection)
+            continue;
+        for (uint32_t i = 0; i < count; ++i) {
+            assert(indices[i] < m_count && (i == 0 || indices[i] < indices[i - 1]));
+            if (fromCollection->IsTriviallyCopyable())
+                fromCollection->CopyBytesTo(indices[i], *toCollection, first + i, 1);
+            else
+                fromCollection->MoveTo(indices[i], *toCollection, first + i, 1);
+        }
+    }
+
+    for (uint32_t i = 0; i < count; ++i)
+        RemoveEntity(indices[i]);
+
+    return first;
+}
+
 inline void Chunk::RemoveEntity (uint32_t index) {
     if (index >= m_count)
         return;
 
     m_count--;
-    for (auto& compIter : m_componentArrays) {
-        IComponentCollection* compCollection = compIter.second;
-        compCollection->Remove(index);
+    MarkStructuralChange();
+    for (auto compArray : m_componentArrays) {
+        if (!compArray->IsTriviallyCopyable())
+            compArray->Remove(index, m_count);
+        else if (index != m_count)
+            compArray->CopyBytesTo(m_count, *compArray, index, 1);
+    }
+
+    if (m_count == 0)
+        m_emptySince = std::chrono::steady_clock::now();
+
+    // Keep a single empty block around so that entities
+    // being added and removed at a boundary don't thrash
+    if (m_blocks.size() > GetBlockCount() + 1)
+        FreeBlock();
+}
+
+inline void Chunk::RemoveAllEntities () {
+    for (auto compArray : m_componentArrays) {
+        if (!compArray->IsTriviallyCopyable())
+            compArray->RemoveAll(m_count);
     }
+    m_count = 0;
+    m_emptySince = std::chrono::steady_clock::now();
+    MarkStructuralChange();
+
+    while (m_blocks.size() > 1)
+        FreeBlock();
+}
+
+inline void Chunk::RemoveTransitionsTo (const std::pmr::vector<Chunk*>& destroyed) {
+    auto isDestroyed = [&destroyed](Chunk* chunk) {
+        return std::binary_search(destroyed.begin(), destroyed.end(), chunk);
+    };
+    for (auto iter = m_addTransitions.begin(); iter != m_addTransitions.end();)
+        iter = isDestroyed(iter->second) ? m_addTransitions.erase(iter) : std::next(iter);
+    for (auto iter = m_removeTransitions.begin(); iter != m_removeTransitions.end();)
+        iter = isDestroyed(iter->second) ? m_removeTransitions.erase(iter) : std::next(iter);
+}
+
+inline void Chunk::SetAddTransition (const ComponentFlags& added, Chunk* to) {
+    m_addTransitions[added] = to;
+}
+
+inline void Chunk::SetRemoveTransition (const ComponentFlags& removed, Chunk* to) {
+    m_removeTransitions[removed] = to;
 }
 
 } // namespace impl
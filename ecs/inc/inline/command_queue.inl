@@ -3,150 +3,389 @@
 // License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
 // ----------------------------------------------------------------------------
 
+#include <algorithm>
+#include <cstring>
+
 namespace ecs {
 namespace impl {
 
-// QueuedComponentCollection
+// QueuedComponent
+template<typename T>
+inline const CommandFunctions* QueuedComponent<T>::GetFunctions () {
+    static const CommandFunctions s_functions = {
+        GetComponentId<T>(),
+        (uint32_t)sizeof(T),
+        (uint32_t)alignof(T),
+        &QueuedComponent<T>::AddTo,
+        &QueuedComponent<T>::RemoveFrom,
+        &QueuedComponent<T>::SetValue,
+        &QueuedComponent<T>::MoveConstruct,
+        std::is_trivially_destructible<T>::value ? nullptr : &QueuedComponent<T>::Destroy
+    };
+    return &s_functions;
+}
+
 template<typename T>
-inline void QueuedComponentCollection<T>::Apply (Entity entity, uint32_t index, Manager* mgr) {
-    mgr->AddComponents(entity, m_components[index]);
+inline void QueuedComponent<T>::AddTo (Composition& composition, SharedComponentStore& sharedComponents, const void* component) {
+    const T& value = *static_cast<const T*>(component);
+    composition.SetComponents(value);
+    if constexpr (IsSharedComponent<T>::value)
+        composition.SetSharedValue(GetComponentIndex<T>(), sharedComponents.Intern(value));
+    else
+        ECS_REF(sharedComponents);
 }
 
 template<typename T>
-inline void QueuedComponentCollection<T>::Clear () {
-    m_components.clear();
+inline void QueuedComponent<T>::RemoveFrom (Composition& composition) {
+    composition.RemoveComponents<T>();
+}
+
+template<typename T>
+inline void QueuedComponent<T>::SetValue (Chunk* chunk, uint32_t chunkIndex, const void* component) {
+    // Tags and shared components have no per-entity value, their composition is the value
+    if constexpr (!std::is_empty<T>::value && !IsSharedComponent<T>::value) {
+        if (T* value = chunk->Find<T>(chunkIndex)) {
+            *value = *static_cast<const T*>(component);
+            chunk->MarkChanged(GetComponentIndex<T>());
+        }
+    }
+    else {
+        ECS_REF(chunk);
+        ECS_REF(chunkIndex);
+        ECS_REF(component);
+    }
 }
 
 template<typename T>
-inline uint32_t QueuedComponentCollection<T>::Push (T && component) {
-    m_components.push_back(component);
-    return (uint32_t)m_components.size() - 1;
+inline void QueuedComponent<T>::MoveConstruct (void* to, void* from) {
+    new (to) T(std::move(*static_cast<T*>(from)));
 }
 
 template<typename T>
-inline void ComponentRemover<T>::Apply (Entity entity, Manager* mgr) {
-    mgr->RemoveComponents<T>(entity);
+inline void QueuedComponent<T>::Destroy (void* component) {
+    static_cast<T*>(component)->~T();
+}
+
+// Command
+inline void* Command::GetData () const {
+    return const_cast<byte_t*>(reinterpret_cast<const byte_t*>(this)) + dataOffset;
+}
+
+// CommandBlock
+inline byte_t* CommandBlock::GetData () {
+    return reinterpret_cast<byte_t*>(this + 1);
 }
 
 // CommandQueue
+inline CommandQueue::CommandQueue (std::pmr::memory_resource* resource)
+    : m_resource(resource)
+    , m_segments(resource)
+    , m_mergeSegments(resource)
+    , m_pendingEntities(resource)
+    , m_pendingChanges(resource)
+    , m_pendingLookup(resource)
+    , m_pendingOrder(resource)
+    , m_pendingBatches(resource)
+    , m_pendingChunkIndices(resource)
+{
+}
+
 inline CommandQueue::~CommandQueue () {
-    for (auto& collection : m_queuedComponents)
-        delete collection.second;
-    for (auto& remover : m_componentRemovers)
-        delete remover.second;
+    Clear();
+    while (m_firstBlock) {
+        CommandBlock* block = m_firstBlock;
+        m_firstBlock = block->next;
+        m_resource->deallocate(block, sizeof(CommandBlock) + block->capacity, alignof(std::max_align_t));
+    }
 }
 
 inline bool CommandQueue::IsEmpty () const {
-    return m_commands.empty();
+    return m_commandCount == 0;
 }
 
+// - Applies every queued command in order
+// - Adds and removes are gathered per entity and applied together after the
+//   other commands, so each entity is created or moved once, straight into the
+//   chunk it ends up in, and entities going to the same chunk move together
+// - Entities created, cloned, or spawned take the entity reserved when they were queued
 inline void CommandQueue::Apply (Manager* mgr) {
-    Entity targetEntity;
-    for (const auto& command : m_commands) {
+    // Pending entity that commands without an entity act on
+    uint32_t target = UINT32_MAX;
+    CommandBlock* block = m_firstBlock;
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < m_commandCount; ++i) {
+        const Command& command = *ReadCommand(block, offset);
         switch (command.type) {
-            case ECommandType::AddComponent: {
-                auto iter = m_queuedComponents.find(command.componentId);
-                targetEntity = command.entity.generation == 0 ? targetEntity : command.entity;
-                iter->second->Apply(targetEntity, command.addComponentIndex, mgr);
-            } break;
+            case ECommandType::AddComponent:
+            case ECommandType::RemoveComponent:
+                if (command.entity.generation != 0)
+                    target = FindOrAddPendingEntity(command.entity);
+                if (target != UINT32_MAX)
+                    m_pendingChanges.push_back(PendingChange{ target, &command });
+                break;
             case ECommandType::CloneEntity:
-                targetEntity = mgr->Clone(command.entity);
+                // A copy sees the changes queued for its source before it
+                if (m_pendingLookup.count(command.entity.GetId()))
+                    ApplyPendingChanges(mgr);
+                mgr->CloneReservedInternal(command.entity, command.reserved);
+                target = AddPendingEntity(command.reserved, false);
                 break;
+            case ECommandType::SpawnPrefab: {
+                if (m_pendingLookup.count(command.entity.GetId()))
+                    ApplyPendingChanges(mgr);
+                const uint32_t* count = static_cast<const uint32_t*>(command.GetData());
+                const Entity* spawned = reinterpret_cast<const Entity*>(count + 1);
+                mgr->SpawnPrefabReservedInternal(command.entity, spawned, *count);
+                // Commands without an entity act on the last one spawned
+                target = *count > 0 ? AddPendingEntity(spawned[*count - 1], false) : UINT32_MAX;
+            } break;
             case ECommandType::CreateEntity:
-                targetEntity = mgr->CreateEntityImmediate();
+                target = AddPendingEntity(command.entity, true);
                 break;
-            case ECommandType::DestroyEntity:
-                mgr->DestroyImmediate(command.entity);
-                break;
-            case ECommandType::RemoveComponent: {
-                auto iter = m_componentRemovers.find(command.componentId);
-                targetEntity = command.entity.generation == 0 ? targetEntity : command.entity;
-                iter->second->Apply(targetEntity, mgr);
+            case ECommandType::ReleaseEntities: {
+                const uint32_t* count = static_cast<const uint32_t*>(command.GetData());
+                mgr->ReleaseReservedEntitiesInternal(reinterpret_cast<const Entity*>(count + 1), *count);
+            } break;
+            case ECommandType::DestroyEntity: {
+                auto iter = m_pendingLookup.find(command.entity.GetId());
+                if (iter != m_pendingLookup.end() && m_pendingEntities[iter->second].create)
+                    m_pendingEntities[iter->second].destroyed = true;
+                else
+                    mgr->DestroyImmediate(command.entity);
             } break;
-            case ECommandType::SpawnPrefab:
-                targetEntity = mgr->SpawnPrefab(Prefab{ command.entity });
-                break;
         }
     }
+    ApplyPendingChanges(mgr);
 
-    m_commands.clear();
-    for (auto& collectionIter : m_queuedComponents)
-        collectionIter.second->Clear();
+    Clear();
 }
 
-template<typename T, typename...Args>
-inline void CommandQueue::AddComponents (Entity entity, T component, Args...args) {
-    auto iter = m_queuedComponents.find(GetComponentId<T>());
-    if (iter == m_queuedComponents.end()) {
-        m_queuedComponents.emplace(GetComponentId<T>(), new QueuedComponentCollection<T>());
-        iter = m_queuedComponents.find(GetComponentId<T>());
+inline void CommandQueue::Clear () {
+    if (m_hasDestructibleComponents) {
+        CommandBlock* block = m_firstBlock;
+        uint32_t offset = 0;
+        for (uint32_t i = 0; i < m_commandCount; ++i) {
+            const Command* command = ReadCommand(block, offset);
+            if (command->type == ECommandType::AddComponent && command->functions->destroy)
+                command->functions->destroy(command->GetData());
+        }
     }
 
-    QueuedComponentCollection<T>* collection = static_cast<QueuedComponentCollection<T>*>(iter->second);
+    // Keep the blocks to write over next time
+    for (CommandBlock* block = m_firstBlock; block; block = block->next)
+        block->used = 0;
+    m_writeBlock = m_firstBlock;
+    m_commandCount = 0;
+    m_hasDestructibleComponents = false;
+    m_segments.clear();
+}
 
-    m_commands.push_back(Command{
-        ECommandType::AddComponent,
-        entity,
-        GetComponentId<T>(),
-        collection->Push(std::move(component))
+inline void* CommandQueue::PushCommand (ECommandType type, Entity entity, Entity reserved, const CommandFunctions* functions, uint32_t dataSize, uint32_t dataAlignment) {
+    // Enough for the worst case padding, the exact size depends on where the command lands
+    const uint32_t maxSize = (uint32_t)sizeof(Command) + dataAlignment - 1 + dataSize + (uint32_t)alignof(Command) - 1;
+    if (!m_writeBlock || m_writeBlock->capacity - m_writeBlock->used < maxSize)
+        NextWriteBlock(maxSize);
+
+    byte_t* start = m_writeBlock->GetData() + m_writeBlock->used;
+    const uintptr_t dataAddress = ((uintptr_t)start + sizeof(Command) + dataAlignment - 1) / dataAlignment * dataAlignment;
+    const uint32_t dataOffset = (uint32_t)(dataAddress - (uintptr_t)start);
+    const uint32_t size = (dataOffset + dataSize + (uint32_t)alignof(Command) - 1) / (uint32_t)alignof(Command) * (uint32_t)alignof(Command);
+
+    Command* command = new (start) Command();
+    command->functions = functions;
+    command->entity = entity;
+    command->reserved = reserved;
+    command->size = size;
+    command->dataOffset = (uint16_t)dataOffset;
+    command->type = type;
+
+    m_writeBlock->used += size;
+    ++m_commandCount;
+    return start + dataOffset;
+}
+
+inline void CommandQueue::NextWriteBlock (uint32_t size) {
+    CommandBlock* next = m_writeBlock ? m_writeBlock->next : m_firstBlock;
+
+    // Reuse the next block if the command fits, otherwise insert one that it fits in
+    if (!next || next->capacity < size) {
+        const uint32_t capacity = std::max<uint32_t>(size, ECS_COMMAND_BLOCK_SIZE - (uint32_t)sizeof(CommandBlock));
+        CommandBlock* block = static_cast<CommandBlock*>(m_resource->allocate(sizeof(CommandBlock) + capacity, alignof(std::max_align_t)));
+        block->next = next;
+        block->capacity = capacity;
+        block->used = 0;
+
+        if (m_writeBlock)
+            m_writeBlock->next = block;
+        else
+            m_firstBlock = block;
+        next = block;
+    }
+    m_writeBlock = next;
+}
+
+inline Command* CommandQueue::ReadCommand (CommandBlock*& block, uint32_t& offset) {
+    // Commands that didn't fit at the end of a block start the next one
+    while (offset == block->used) {
+        block = block->next;
+        offset = 0;
+    }
+    Command* command = reinterpret_cast<Command*>(block->GetData() + offset);
+    offset += command->size;
+    return command;
+}
+
+inline uint32_t CommandQueue::AddPendingEntity (Entity entity, bool create) {
+    PendingEntity pending;
+    pending.entity = entity;
+    pending.create = create;
+    m_pendingEntities.push_back(pending);
+
+    const uint32_t index = (uint32_t)m_pendingEntities.size() - 1;
+    m_pendingLookup[entity.GetId()] = index;
+    return index;
+}
+
+inline uint32_t CommandQueue::FindOrAddPendingEntity (Entity entity) {
+    auto iter = m_pendingLookup.find(entity.GetId());
+    if (iter != m_pendingLookup.end())
+        return iter->second;
+    return AddPendingEntity(entity, false);
+}
+
+inline void CommandQueue::ApplyPendingChanges (Manager* mgr) {
+    if (!m_pendingEntities.empty())
+        mgr->ApplyPendingChangesInternal(*this);
+
+    m_pendingEntities.clear();
+    m_pendingChanges.clear();
+    m_pendingLookup.clear();
+}
+
+inline void CommandQueue::ApplyPendingChangeTo (const PendingChange& change, Composition& composition, SharedComponentStore& sharedComponents) const {
+    const Command& command = *change.command;
+    if (command.type == ECommandType::AddComponent)
+        command.functions->addTo(composition, sharedComponents, command.GetData());
+    else
+        command.functions->removeFrom(composition);
+}
+
+inline void CommandQueue::SetPendingValue (const PendingChange& change, Chunk* chunk, uint32_t chunkIndex) const {
+    const Command& command = *change.command;
+    if (command.type == ECommandType::AddComponent)
+        command.functions->setValue(chunk, chunkIndex, command.GetData());
+}
+
+inline void CommandQueue::Swap (CommandQueue& other) {
+    assert(m_resource == other.m_resource);
+    std::swap(m_firstBlock, other.m_firstBlock);
+    std::swap(m_writeBlock, other.m_writeBlock);
+    std::swap(m_commandCount, other.m_commandCount);
+    std::swap(m_hasDestructibleComponents, other.m_hasDestructibleComponents);
+    m_segments.swap(other.m_segments);
+}
+
+inline void CommandQueue::BeginSegment (uint32_t order) {
+    // A segment with no commands would be empty, reuse it
+    if (!m_segments.empty() && m_segments.back().first == m_commandCount)
+        m_segments.back().order = order;
+    else
+        m_segments.push_back(CommandSegment{ order, m_commandCount, m_writeBlock, m_writeBlock ? m_writeBlock->used : 0 });
+}
+
+inline void CommandQueue::MergeFrom (CommandQueue* const* queues, uint32_t count) {
+    m_mergeSegments.clear();
+    for (uint32_t i = 0; i < count; ++i) {
+        CommandQueue* queue = queues[i];
+        const uint32_t commandCount = queue->m_commandCount;
+        if (commandCount == 0)
+            continue;
+
+        if (queue->m_segments.empty() || queue->m_segments.front().first > 0) {
+            const uint32_t end = queue->m_segments.empty() ? commandCount : queue->m_segments.front().first;
+            m_mergeSegments.push_back(MergeSegment{ 0, end, queue->m_firstBlock, 0 });
+        }
+        for (size_t j = 0; j < queue->m_segments.size(); ++j) {
+            const CommandSegment& segment = queue->m_segments[j];
+            const uint32_t end = j + 1 < queue->m_segments.size() ? queue->m_segments[j + 1].first : commandCount;
+            // Segments begun before anything was written start at the first block
+            if (end > segment.first)
+                m_mergeSegments.push_back(MergeSegment{ segment.order, end - segment.first, segment.block ? segment.block : queue->m_firstBlock, segment.offset });
+        }
+    }
+
+    // Segments were gathered in queue order, a stable sort keeps it for equal orders
+    std::stable_sort(m_mergeSegments.begin(), m_mergeSegments.end(), [](const MergeSegment& lhs, const MergeSegment& rhs) {
+        return lhs.order < rhs.order;
     });
 
+    for (const MergeSegment& segment : m_mergeSegments) {
+        CommandBlock* block = segment.block;
+        uint32_t offset = segment.offset;
+        for (uint32_t i = 0; i < segment.count; ++i) {
+            Command* command = ReadCommand(block, offset);
+            if (command->type != ECommandType::AddComponent) {
+                // The data of other commands is trivially copyable
+                const uint32_t dataSize = command->size - command->dataOffset;
+                void* data = PushCommand(command->type, command->entity, command->reserved, command->functions, dataSize, (uint32_t)alignof(Entity));
+                std::memcpy(data, command->GetData(), dataSize);
+                continue;
+            }
+
+            const CommandFunctions* functions = command->functions;
+            void* component = PushCommand(command->type, command->entity, command->reserved, functions, functions->size, functions->alignment);
+            functions->moveConstruct(component, command->GetData());
+            m_hasDestructibleComponents = m_hasDestructibleComponents || functions->destroy;
+        }
+    }
+    m_mergeSegments.clear();
+
+    for (uint32_t i = 0; i < count; ++i)
+        queues[i]->Clear();
+}
+
+template<typename T, typename...Args>
+inline void CommandQueue::AddComponents (Entity entity, T component, Args...args) {
+    const CommandFunctions* functions = QueuedComponent<T>::GetFunctions();
+    void* queued = PushCommand(ECommandType::AddComponent, entity, Entity{}, functions, (uint32_t)sizeof(T), (uint32_t)alignof(T));
+    new (queued) T(std::move(component));
+    m_hasDestructibleComponents = m_hasDestructibleComponents || !std::is_trivially_destructible<T>::value;
+
     AddComponents(entity, args...);
 }
 
-inline void CommandQueue::CloneEntity (Entity entity) {
-    m_commands.push_back(Command{
-        ECommandType::CloneEntity,
-        entity,
-        0,  // ComponentId
-        0   // ComponentIndex
-    });
+inline void CommandQueue::CloneEntity (Entity entity, Entity reserved) {
+    PushCommand(ECommandType::CloneEntity, entity, reserved, nullptr, 0, 1);
 }
 
 template<typename T, typename...Args>
-inline void CommandQueue::CreateEntity (T component, Args...args) {
-    m_commands.push_back(Command{
-        ECommandType::CreateEntity,
-        Entity{},
-        0,  // ComponentId
-        0   // ComponentIndex
-    });
+inline void CommandQueue::CreateEntity (Entity reserved, T component, Args...args) {
+    PushCommand(ECommandType::CreateEntity, reserved, Entity{}, nullptr, 0, 1);
 
-    AddComponents(Entity{}, component, args...);
+    AddComponents(reserved, component, args...);
 }
 
 inline void CommandQueue::DestroyEntity (Entity entity) {
-    m_commands.push_back(Command{
-        ECommandType::DestroyEntity,
-        entity,
-        0,  // ComponentId
-        0   // ComponentIndex
-    });
+    PushCommand(ECommandType::DestroyEntity, entity, Entity{}, nullptr, 0, 1);
+}
+
+inline Entity* CommandQueue::ReleaseEntities (uint32_t count) {
+    void* data = PushCommand(ECommandType::ReleaseEntities, Entity{}, Entity{}, nullptr, (uint32_t)(sizeof(uint32_t) + count * sizeof(Entity)), (uint32_t)alignof(Entity));
+    *static_cast<uint32_t*>(data) = count;
+    return reinterpret_cast<Entity*>(static_cast<uint32_t*>(data) + 1);
 }
 
 template<typename T, typename...Args>
 inline void CommandQueue::RemoveComponents (Entity entity) {
-    auto iter = m_componentRemovers.find(GetComponentId<T>());
-    if (iter == m_componentRemovers.end())
-        m_componentRemovers.emplace(GetComponentId<T>(), new ComponentRemover<T>());
-
-    m_commands.push_back(Command{
-        ECommandType::RemoveComponent,
-        entity,
-        GetComponentId<T>(),
-        0   // ComponentIndex
-    });
+    PushCommand(ECommandType::RemoveComponent, entity, Entity{}, QueuedComponent<T>::GetFunctions(), 0, 1);
 
     RemoveComponents<Args...>(entity);
 }
 
-inline void CommandQueue::SpawnPrefab (Prefab prefab) {
-    m_commands.push_back(Command{
-        ECommandType::SpawnPrefab,
-        prefab.m_entity,
-        0,  // ComponentId
-        0   // ComponentIndex
-    });
+inline Entity* CommandQueue::SpawnPrefab (Prefab prefab, uint32_t count) {
+    void* data = PushCommand(ECommandType::SpawnPrefab, prefab.m_entity, Entity{}, nullptr, (uint32_t)(sizeof(uint32_t) + count * sizeof(Entity)), (uint32_t)alignof(Entity));
+    *static_cast<uint32_t*>(data) = count;
+    return reinterpret_cast<Entity*>(static_cast<uint32_t*>(data) + 1);
 }
 
 } // namespace impl
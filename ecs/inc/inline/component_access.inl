@@ -13,7 +13,7 @@ struct IComponentAccess {
     inline IComponentAccess (Job& job) : m_job(job) {}
     virtual void ApplyTo (ComponentFlags &) = 0;
     virtual void OnCreate () = 0;
-    virtual void UpdateChunk (Chunk *) {}
+    virtual void UpdateChunk (Chunk *, uint32_t) {}
     virtual void UpdateManager () {}
 
 protected:
@@ -32,7 +32,7 @@ struct DataComponentAccess : public IComponentAccess {
     static_assert(!std::is_empty<T>(), "Cannot access an empty/tag component");
     inline DataComponentAccess (Job& job) : IComponentAccess(job) {}
     inline void ApplyTo (ComponentFlags& flags) override { flags.SetFlags<T>(); }
-    inline void UpdateChunk (Chunk* chunk) { this->m_componentArray = chunk->Find<T>(); }
+    inline void UpdateChunk (Chunk* chunk, uint32_t block) override { this->m_componentArray = chunk->template Find<T>(block * chunk->GetBlockCapacity()); }
 protected:
     T* m_componentArray = nullptr;
 };
@@ -55,6 +55,12 @@ protected:
 };
 
 // Actual component access
+template<typename T, typename...Args>
+struct Changed : public CompositionAccess<T, Args...> {
+    inline Changed (Job& job) : CompositionAccess<T, Args...>(job) { OnCreate(); }
+    inline void OnCreate () override { this->m_job.AddChanged(this); }
+};
+
 template<typename T, typename...Args>
 struct Exclude : public CompositionAccess<T, Args...> {
     inline Exclude (Job& job) : CompositionAccess<T, Args...>(job) { OnCreate(); }
@@ -81,6 +87,18 @@ struct ReadOther : public LookupComponentAccess<T> {
     inline const T* Find (Entity entity) const { return this->m_job.m_manager->FindComponent<T>(entity); }
 };
 
+template<typename T>
+struct ReadShared : public IComponentAccess {
+    inline ReadShared (Job& job) : IComponentAccess(job) { OnCreate(); }
+    inline void ApplyTo (ComponentFlags& flags) override { flags.SetFlags<T>(); }
+    inline void OnCreate () override { this->m_job.AddReadShared(this); }
+    inline void UpdateChunk (Chunk* chunk, uint32_t) override { this->m_sharedComponent = chunk->template FindShared<T>(); }
+    inline const T& operator* () const { return *this->m_sharedComponent; }
+    inline const T* operator-> () const { return this->m_sharedComponent; }
+private:
+    const T* m_sharedComponent = nullptr;
+};
+
 template<typename T>
 struct ReadSingleton : public SingletonComponentAccess<T> {
     inline ReadSingleton (Job& job) : SingletonComponentAccess<T>(job) { OnCreate(); }
@@ -105,6 +123,10 @@ template<typename T>
 struct Write : public DataComponentAccess<T> {
     inline Write (Job& job) : DataComponentAccess<T>(job) { OnCreate(); }
     inline void OnCreate () override { this->m_job.AddWrite(this); }
+    inline void UpdateChunk (Chunk* chunk, uint32_t block) override {
+        DataComponentAccess<T>::UpdateChunk(chunk, block);
+        chunk->MarkChanged(GetComponentIndex<T>(), this->m_job.m_runVersion);
+    }
     inline T* GetChunkComponentArray () const { return this->m_componentArray; }
     inline T& operator* () const { return this->m_componentArray[this->m_job.m_entityIndex]; }
     inline T* operator-> () const { return this->m_componentArray + this->m_job.m_entityIndex; }
@@ -114,7 +136,7 @@ template<typename T>
 struct WriteOther : public LookupComponentAccess<T> {
     inline WriteOther (Job& job) : LookupComponentAccess<T>(job) { OnCreate(); }
     inline void OnCreate () override { this->m_job.AddWriteOther(this); }
-    inline T* Find (Entity entity) const { return this->m_job.m_manager->FindComponent<T>(entity); }
+    inline T* Find (Entity entity) const { return this->m_job.template FindOtherForWrite<T>(entity); }
 };
 
 template<typename T>
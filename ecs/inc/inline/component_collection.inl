@@ -3,52 +3,165 @@
 // License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
 // ----------------------------------------------------------------------------
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <new>
+#include <type_traits>
 
 namespace ecs {
 namespace impl {
 
+// IComponentCollection
+inline IComponentCollection::IComponentCollection (ComponentIndex componentIndex, bool triviallyCopyable)
+    : m_componentIndex(componentIndex)
+    , m_triviallyCopyable(triviallyCopyable)
+{
+}
+
+inline void IComponentCollection::CopyBytesTo (uint32_t fromIndex, IComponentCollection& to, uint32_t toIndex, uint32_t count) const {
+    assert(m_triviallyCopyable && m_componentIndex == to.m_componentIndex);
+
+    // Copy whatever runs are contiguous in both collections' blocks
+    while (count > 0) {
+        uint32_t runCount = std::min(count, std::min(GetContiguousCount(fromIndex), to.GetContiguousCount(toIndex)));
+        std::memcpy(to.GetComponentAtIndex(toIndex), GetComponentAtIndex(fromIndex), runCount * m_componentSize);
+        fromIndex += runCount;
+        toIndex += runCount;
+        count -= runCount;
+    }
+}
+
+// - Fills each contiguous run by doubling, copying the bytes written so far
+//   instead of the single source component
+inline void IComponentCollection::FillBytesTo (uint32_t fromIndex, IComponentCollection& to, uint32_t toIndex, uint32_t count) const {
+    assert(m_triviallyCopyable && m_componentIndex == to.m_componentIndex);
+
+    const void* value = GetComponentAtIndex(fromIndex);
+    while (count > 0) {
+        const uint32_t runCount = std::min(count, to.GetContiguousCount(toIndex));
+        byte_t* run = static_cast<byte_t*>(to.GetComponentAtIndex(toIndex));
+        std::memcpy(run, value, m_componentSize);
+        for (uint32_t filled = 1; filled < runCount;) {
+            const uint32_t copyCount = std::min(filled, runCount - filled);
+            std::memcpy(run + filled * m_componentSize, run, copyCount * m_componentSize);
+            filled += copyCount;
+        }
+        toIndex += runCount;
+        count -= runCount;
+    }
+}
+
 template<typename T>
 inline T* IComponentCollection::Get (uint32_t index) {
-    assert(::ecs::impl::GetComponentId<T>() == GetComponentId());
+    assert(::ecs::impl::GetComponentIndex<T>() == m_componentIndex);
     return static_cast<T*>(GetComponentAtIndex(index));
 }
 
+inline void* IComponentCollection::GetComponentAtIndex (uint32_t index) const {
+    byte_t* block = (*m_blocks)[index / m_blockCapacity];
+    return block + m_blockOffset + (index % m_blockCapacity) * m_componentSize;
+}
+
+inline ComponentIndex IComponentCollection::GetComponentIndex () const {
+    return m_componentIndex;
+}
+
+inline uint32_t IComponentCollection::GetChangeVersion () const {
+    return m_changeVersion.load(std::memory_order_relaxed);
+}
+
+inline void IComponentCollection::SetChangeVersion (uint32_t version) {
+    m_changeVersion.store(version, std::memory_order_relaxed);
+}
+
+inline uint32_t IComponentCollection::GetContiguousCount (uint32_t index) const {
+    return m_blockCapacity - index % m_blockCapacity;
+}
+
+inline bool IComponentCollection::IsTriviallyCopyable () const {
+    return m_triviallyCopyable;
+}
+
+inline void IComponentCollection::SetLayout (const std::pmr::vector<byte_t*>* blocks, uint32_t blockCapacity, size_t blockOffset) {
+    m_blocks = blocks;
+    m_blockCapacity = blockCapacity;
+    m_blockOffset = blockOffset;
+    m_componentSize = GetSize();
+}
+
+// TComponentCollection
 template<typename T>
-uint32_t TComponentCollection<T>::Allocate () {
-    m_components.push_back(T());
-    return m_components.size() - 1;
+TComponentCollection<T>::TComponentCollection ()
+    : IComponentCollection(::ecs::impl::GetComponentIndex<T>(), std::is_trivially_copyable<T>::value)
+{
+}
+
+template<typename T>
+size_t TComponentCollection<T>::GetAlignment () const {
+    return alignof(T);
+}
+
+template<typename T>
+size_t TComponentCollection<T>::GetSize () const {
+    return sizeof(T);
+}
+
+template<typename T>
+void TComponentCollection<T>::Allocate (uint32_t first, uint32_t count) {
+    for (uint32_t i = first; i < first + count; ++i)
+        new (At(i)) T();
 }
 
 template<typename T>
 void TComponentCollection<T>::CopyTo (uint32_t from, uint32_t to) {
-    m_components[to] = m_components[from];
+    *At(to) = *At(from);
 }
 
 template<typename T>
-void TComponentCollection<T>::MoveTo (uint32_t fromIndex, IComponentCollection& to, uint32_t toIndex) {
-    std::swap(m_components[fromIndex], *to.Get<T>(toIndex));
+void TComponentCollection<T>::FillTo (uint32_t fromIndex, IComponentCollection& to, uint32_t toIndex, uint32_t count) {
+    const T& value = *At(fromIndex);
+    while (count > 0) {
+        uint32_t runCount = std::min(count, to.GetContiguousCount(toIndex));
+        std::fill_n(to.Get<T>(toIndex), runCount, value);
+        toIndex += runCount;
+        count -= runCount;
+    }
 }
 
 template<typename T>
-void TComponentCollection<T>::Remove (uint32_t index) {
-    std::swap(m_components[index], m_components[m_components.size() - 1]);
-    m_components.pop_back();
+void TComponentCollection<T>::MoveTo (uint32_t fromIndex, IComponentCollection& to, uint32_t toIndex, uint32_t count) {
+    // Move whatever runs are contiguous in both collections' blocks
+    while (count > 0) {
+        uint32_t runCount = std::min(count, std::min(GetContiguousCount(fromIndex), to.GetContiguousCount(toIndex)));
+        std::move(At(fromIndex), At(fromIndex) + runCount, to.Get<T>(toIndex));
+        fromIndex += runCount;
+        toIndex += runCount;
+        count -= runCount;
+    }
 }
 
 template<typename T>
-void TComponentCollection<T>::RemoveAll () {
-    m_components.clear();
+void TComponentCollection<T>::Remove (uint32_t index, uint32_t lastIndex) {
+    if (index != lastIndex)
+        *At(index) = std::move(*At(lastIndex));
+    At(lastIndex)->~T();
 }
 
 template<typename T>
-void* TComponentCollection<T>::GetComponentAtIndex (uint32_t index) {
-    return &m_components[index];
+void TComponentCollection<T>::RemoveAll (uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i)
+        At(i)->~T();
 }
 
 template<typename T>
-ComponentId TComponentCollection<T>::GetComponentId () const {
-    return ::ecs::impl::GetComponentId<T>();
+void TComponentCollection<T>::Free (std::pmr::memory_resource* resource) {
+    DeleteObject(resource, this);
+}
+
+template<typename T>
+inline T* TComponentCollection<T>::At (uint32_t index) {
+    return static_cast<T*>(GetComponentAtIndex(index));
 }
 
 } // namespace impl
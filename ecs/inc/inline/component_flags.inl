@@ -3,76 +3,117 @@
 // License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
 // ----------------------------------------------------------------------------
 
+#include "../helpers/bit_scan.h"
+
+#include <cassert>
+
 namespace ecs {
 namespace impl {
 
+// ComponentFlagIterator
+inline ComponentFlagIterator::ComponentFlagIterator (const ComponentFlags& flags, ComponentIndex index)
+    : m_flags(flags)
+    , m_index(index)
+{
+    SkipUnset();
+}
+
+inline ComponentIndex ComponentFlagIterator::operator* () const {
+    return m_index;
+}
+
+inline ComponentFlagIterator& ComponentFlagIterator::operator++ () {
+    ++m_index;
+    SkipUnset();
+    return *this;
+}
+
+inline bool ComponentFlagIterator::operator!= (const ComponentFlagIterator& rhs) const {
+    return m_index != rhs.m_index;
+}
+
+inline void ComponentFlagIterator::SkipUnset () {
+    const ComponentIndex end = ComponentFlags::WORD_COUNT * ComponentFlags::BITS_PER_WORD;
+    while (m_index < end) {
+        uint32_t word = m_index / ComponentFlags::BITS_PER_WORD;
+        uint64_t remaining = m_flags.m_words[word] >> (m_index % ComponentFlags::BITS_PER_WORD);
+        if (remaining) {
+            m_index += CountTrailingZeros(remaining);
+            return;
+        }
+        m_index = (word + 1) * ComponentFlags::BITS_PER_WORD;
+    }
+    m_index = end;
+}
+
 // ComponentFlags
 inline ComponentFlags::ComponentFlags () {
     Clear();
 }
 
 inline void ComponentFlags::Clear () {
-    m_flags.clear();
+    for (uint32_t i = 0; i < WORD_COUNT; ++i)
+        m_words[i] = 0;
 }
 
-inline void ComponentFlags::ClearFlag (ComponentId id) {
-    m_flags.erase(id);
+inline void ComponentFlags::ClearFlag (ComponentIndex index) {
+    assert(index < ECS_MAX_COMPONENT_TYPES);
+    m_words[index / BITS_PER_WORD] &= ~(uint64_t(1) << (index % BITS_PER_WORD));
 }
 
 template<typename T, typename...Args>
 inline void ComponentFlags::ClearFlags () {
-    ClearFlag(GetComponentId<T>());
+    ClearFlag(GetComponentIndex<T>());
     ClearFlags<Args...>();
 }
 
 inline void ComponentFlags::ClearFlags (const ComponentFlags& rhs) {
-    for (const ComponentId& id : rhs.m_flags)
-        ClearFlag(id);
+    for (uint32_t i = 0; i < WORD_COUNT; ++i)
+        m_words[i] &= ~rhs.m_words[i];
 }
 
-inline void ComponentFlags::SetFlag (ComponentId id) {
-    m_flags.emplace(id);
+inline void ComponentFlags::SetFlag (ComponentIndex index) {
+    assert(index < ECS_MAX_COMPONENT_TYPES);
+    m_words[index / BITS_PER_WORD] |= uint64_t(1) << (index % BITS_PER_WORD);
 }
 
 template<typename T, typename...Args>
 inline void ComponentFlags::SetFlags () {
-    SetFlag(GetComponentId<T>());
+    SetFlag(GetComponentIndex<T>());
     SetFlags<Args...>();
 }
 
 inline void ComponentFlags::SetFlags (const ComponentFlags& rhs) {
-    for (const ComponentId& id : rhs.m_flags)
-        SetFlag(id);
+    for (uint32_t i = 0; i < WORD_COUNT; ++i)
+        m_words[i] |= rhs.m_words[i];
 }
 
 inline ComponentFlagIterator ComponentFlags::begin () const {
-    return m_flags.begin();
+    return ComponentFlagIterator(*this, 0);
 }
 
 inline ComponentFlagIterator ComponentFlags::end () const {
-    return m_flags.end();
+    return ComponentFlagIterator(*this, WORD_COUNT * BITS_PER_WORD);
 }
 
 inline size_t ComponentFlags::GetHash () const {
-    // Since component ids are already hashes themselves, and we don't want
-    // order to matter, we can just add all of the flags together to combine
-    ComponentId hash = 0;
-    for (const ComponentId& id : m_flags)
-        hash += id;
+    uint64_t hash = 0;
+    for (uint32_t i = 0; i < WORD_COUNT; ++i)
+        hash = (hash ^ m_words[i]) * 1099511628211ull; // FNV-1 prime
     return (size_t)hash;
 }
 
 inline bool ComponentFlags::HasAll (const ComponentFlags& rhs) const {
-    for (const ComponentId& id : rhs.m_flags) {
-        if (!Has(id))
+    for (uint32_t i = 0; i < WORD_COUNT; ++i) {
+        if ((m_words[i] & rhs.m_words[i]) != rhs.m_words[i])
             return false;
     }
     return true;
 }
 
 inline bool ComponentFlags::HasAny (const ComponentFlags& rhs) const {
-    for (const ComponentId& id : rhs.m_flags) {
-        if (Has(id))
+    for (uint32_t i = 0; i < WORD_COUNT; ++i) {
+        if (m_words[i] & rhs.m_words[i])
             return true;
     }
     return false;
@@ -82,12 +123,38 @@ inline bool ComponentFlags::HasNone (const ComponentFlags& rhs) const {
     return !HasAny(rhs);
 }
 
-inline bool ComponentFlags::Has (ComponentId id) const {
-    return m_flags.find(id) != m_flags.end();
+inline bool ComponentFlags::Has (ComponentIndex index) const {
+    assert(index < ECS_MAX_COMPONENT_TYPES);
+    return (m_words[index / BITS_PER_WORD] >> (index % BITS_PER_WORD)) & 1;
+}
+
+inline bool ComponentFlags::IsEmpty () const {
+    for (uint32_t i = 0; i < WORD_COUNT; ++i) {
+        if (m_words[i])
+            return false;
+    }
+    return true;
 }
 
 inline bool ComponentFlags::operator== (const ComponentFlags& rhs) const {
-    return m_flags == rhs.m_flags;
+    for (uint32_t i = 0; i < WORD_COUNT; ++i) {
+        if (m_words[i] != rhs.m_words[i])
+            return false;
+    }
+    return true;
+}
+
+template<typename T, typename...Args>
+inline ComponentFlags MakeComponentFlags () {
+    ComponentFlags flags;
+    flags.SetFlags<T, Args...>();
+    return flags;
+}
+
+template<typename T, typename...Args>
+inline const ComponentFlags& StaticComponentFlags () {
+    static const ComponentFlags s_flags = MakeComponentFlags<T, Args...>();
+    return s_flags;
 }
 
 } // namespace impl
@@ -0,0 +1,71 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+#include <cassert>
+
+namespace ecs {
+namespace impl {
+
+template<typename T>
+inline IComponentCollection* AllocComponentCollection (std::pmr::memory_resource* resource) {
+    return NewObject<TComponentCollection<T>>(resource);
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_empty<T>::value || std::is_base_of<ISingletonComponent, T>::value || IsSharedComponent<T>::value, ComponentCollectionAllocateFunc>::type GetComponentCollectionAllocateFunc () {
+    return nullptr;
+}
+
+template<typename T>
+inline typename std::enable_if<!std::is_empty<T>::value && !std::is_base_of<ISingletonComponent, T>::value && !IsSharedComponent<T>::value, ComponentCollectionAllocateFunc>::type GetComponentCollectionAllocateFunc () {
+    return &AllocComponentCollection<T>;
+}
+
+// ComponentRegistry
+template<typename T>
+inline ComponentIndex ComponentRegistry::RegisterComponent () {
+    ComponentIndex index = GetCounter()++;
+    assert(index < ECS_MAX_COMPONENT_TYPES); // Increase ECS_MAX_COMPONENT_TYPES
+
+    ComponentInfo& info = GetInfos()[index];
+    info.id = GetComponentId<T>();
+    info.allocateCollection = GetComponentCollectionAllocateFunc<T>();
+
+    return index;
+}
+
+inline const ComponentInfo& ComponentRegistry::GetInfo (ComponentIndex index) {
+    assert(index < GetCounter());
+    return GetInfos()[index];
+}
+
+inline ComponentInfo* ComponentRegistry::GetInfos () {
+    static ComponentInfo s_infos[ECS_MAX_COMPONENT_TYPES];
+    return s_infos;
+}
+
+inline std::atomic<ComponentIndex>& ComponentRegistry::GetCounter () {
+    static std::atomic<ComponentIndex> s_counter(0);
+    return s_counter;
+}
+
+template<typename T>
+struct ComponentIndexGetter {
+    static ComponentIndex GetIndex ();
+};
+
+template<typename T>
+inline ComponentIndex ComponentIndexGetter<T>::GetIndex () {
+    static ComponentIndex s_index = ComponentRegistry::RegisterComponent<T>();
+    return s_index;
+}
+
+template<typename T>
+inline ComponentIndex GetComponentIndex () {
+    return ComponentIndexGetter<typename std::remove_const<T>::type>::GetIndex();
+}
+
+} // namespace impl
+} // namespace ecs
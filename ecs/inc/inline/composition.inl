@@ -8,42 +8,72 @@
 namespace ecs {
 namespace impl {
 
-template<typename T>
-inline IComponentCollection* AllocComponentCollection () {
-    return new TComponentCollection<T>();
-}
-
 inline const ComponentFlags& Composition::GetComponentFlags () const {
     return m_flags;
 }
 
-inline const ComponentCollectionFactory& Composition::GetComponentCollectionFactory () const {
-    return m_componentCollectionFactory;
+inline uint32_t Composition::GetSharedValueCount () const {
+    return m_sharedValueCount;
+}
+
+inline const SharedValue& Composition::GetSharedValue (uint32_t index) const {
+    assert(index < m_sharedValueCount);
+    return m_sharedValues[index];
+}
+
+inline void Composition::SetSharedValue (ComponentIndex componentIndex, uint32_t valueId) {
+    uint32_t index = 0;
+    while (index < m_sharedValueCount && m_sharedValues[index].componentIndex < componentIndex)
+        ++index;
+
+    if (index == m_sharedValueCount || m_sharedValues[index].componentIndex != componentIndex) {
+        assert(m_sharedValueCount < ECS_MAX_SHARED_COMPONENTS); // Increase ECS_MAX_SHARED_COMPONENTS
+        for (uint32_t i = m_sharedValueCount; i > index; --i)
+            m_sharedValues[i] = m_sharedValues[i - 1];
+        ++m_sharedValueCount;
+    }
+    m_sharedValues[index] = SharedValue{ componentIndex, valueId };
 }
 
 inline size_t Composition::GetHash () const {
-    return m_flags.GetHash();
+    size_t hash = m_flags.GetHash();
+    for (uint32_t i = 0; i < m_sharedValueCount; ++i)
+        hash = hash * 31 + m_sharedValues[i].valueId;
+    return hash;
 }
 
 inline bool Composition::operator== (const Composition& rhs) const {
-    return m_flags == rhs.m_flags;
+    if (!(m_flags == rhs.m_flags) || m_sharedValueCount != rhs.m_sharedValueCount)
+        return false;
+    for (uint32_t i = 0; i < m_sharedValueCount; ++i) {
+        if (m_sharedValues[i].componentIndex != rhs.m_sharedValues[i].componentIndex || m_sharedValues[i].valueId != rhs.m_sharedValues[i].valueId)
+            return false;
+    }
+    return true;
 }
 
 inline void Composition::Clear () {
     m_flags.Clear();
-    m_componentCollectionFactory.clear();
+    for (uint32_t i = 0; i < m_sharedValueCount; ++i)
+        m_sharedValues[i] = SharedValue{};
+    m_sharedValueCount = 0;
 }
 
 template<typename T, typename...Args>
 inline void Composition::RemoveComponents () {
-    if (m_flags.Has<T>()) {
-        m_flags.ClearFlags<T>();
+    m_flags.ClearFlags<T, Args...>();
+    RemoveClearedSharedValues();
+}
 
-        if (!std::is_empty<T>())
-            m_componentCollectionFactory.erase(GetComponentId<T>());
+inline void Composition::RemoveClearedSharedValues () {
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < m_sharedValueCount; ++i) {
+        if (m_flags.Has(m_sharedValues[i].componentIndex))
+            m_sharedValues[kept++] = m_sharedValues[i];
     }
-    RemoveComponents<Args...>();
-    m_flags.ClearFlags<T, Args...>();
+    for (uint32_t i = kept; i < m_sharedValueCount; ++i)
+        m_sharedValues[i] = SharedValue{};
+    m_sharedValueCount = kept;
 }
 
 template<typename T, typename...Args>
@@ -56,12 +86,7 @@ inline void Composition::SetComponentsInternal () {};
 template<typename T, typename...Args>
 inline void Composition::SetComponentsInternal (T component, Args...args) {
     ECS_REF(component);
-    if (!m_flags.Has<T>()) {
-        m_flags.SetFlags<T>();
-
-        if (!std::is_empty<T>())
-            m_componentCollectionFactory.emplace(GetComponentId<T>(), &AllocComponentCollection<T>);
-    }
+    m_flags.SetFlags<T>();
     SetComponentsInternal(args...);
 }
 
@@ -0,0 +1,71 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+namespace ecs {
+
+inline Filter::Filter () {
+    m_exclude.SetFlags<impl::PrefabComponent>();
+}
+
+// - Entities with any of these components will not match
+template<typename T, typename...Args>
+inline Filter& Filter::Exclude () {
+    m_exclude.SetFlags<T, Args...>();
+    return *this;
+}
+
+// - Entities must have all of these components to match
+template<typename T, typename...Args>
+inline Filter& Filter::Require () {
+    m_required.SetFlags<T, Args...>();
+    return *this;
+}
+
+// - Entities must have at least one of these components to match
+// - Each call adds a separate group that must be satisfied
+template<typename T, typename...Args>
+inline Filter& Filter::RequireAny () {
+    impl::ComponentFlags any;
+    any.SetFlags<T, Args...>();
+    m_requireAny.push_back(any);
+    return *this;
+}
+
+inline bool Filter::Matches (const impl::ComponentFlags& flags) const {
+    if (!flags.HasAll(m_required))
+        return false;
+    if (!flags.HasNone(m_exclude))
+        return false;
+    for (const auto& any : m_requireAny) {
+        if (!flags.HasAny(any))
+            return false;
+    }
+    return true;
+}
+
+inline size_t Filter::GetHash () const {
+    return GetHash(m_required);
+}
+
+inline size_t Filter::GetHash (const impl::ComponentFlags& required) const {
+    uint64_t hash = required.GetHash();
+    hash = (hash ^ m_exclude.GetHash()) * 1099511628211ull; // FNV-1 prime
+    for (const auto& any : m_requireAny)
+        hash = (hash ^ any.GetHash()) * 1099511628211ull;
+    return (size_t)hash;
+}
+
+// - Filters built from the same calls in the same order are equal
+inline bool Filter::operator== (const Filter& rhs) const {
+    return Equals(rhs, m_required);
+}
+
+inline bool Filter::Equals (const Filter& rhs, const impl::ComponentFlags& required) const {
+    return required == rhs.m_required
+        && m_exclude == rhs.m_exclude
+        && m_requireAny == rhs.m_requireAny;
+}
+
+} // namespace ecs
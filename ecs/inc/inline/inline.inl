@@ -5,13 +5,23 @@
 
 #pragma once
 
+#include "block_pool.inl"
+#include "change_version.inl"
 #include "chunk.inl"
 #include "command_queue.inl"
 #include "component.inl"
 #include "component_access.inl"
 #include "component_collection.inl"
 #include "component_flags.inl"
+#include "component_registry.inl"
 #include "composition.inl"
 #include "entity.inl"
+#include "filter.inl"
 #include "job.inl"
+#include "job_graph.inl"
+#include "job_handle.inl"
+#include "job_signature.inl"
 #include "manager.inl"
+#include "query.inl"
+#include "scheduler.inl"
+#include "shared_component_store.inl"
@@ -6,13 +6,23 @@
 namespace ecs {
 
 // Job
+inline Job::~Job () {
+    for (Job* instance : m_parallelInstances)
+        delete instance;
+}
+
+inline void Job::AddChanged (impl::IComponentAccess* access) {
+    access->ApplyTo(m_changed);
+    access->ApplyTo(m_filter.m_required);
+}
+
 inline void Job::AddExclude (impl::IComponentAccess* access) {
-    access->ApplyTo(m_exclude);
+    access->ApplyTo(m_filter.m_exclude);
 }
 
 inline void Job::AddRead (impl::IComponentAccess* access) {
     access->ApplyTo(m_read);
-    access->ApplyTo(m_required);
+    access->ApplyTo(m_filter.m_required);
     m_dataAccess.push_back(access);
 }
 
@@ -20,24 +30,30 @@ inline void Job::AddReadOther (impl::IComponentAccess* access) {
     access->ApplyTo(m_read);
 }
 
+inline void Job::AddReadShared (impl::IComponentAccess* access) {
+    access->ApplyTo(m_read);
+    access->ApplyTo(m_filter.m_required);
+    m_dataAccess.push_back(access);
+}
+
 inline void Job::AddReadSingleton (impl::IComponentAccess* access) {
     access->ApplyTo(m_read);
     m_singletonAccess.push_back(access);
 }
 
 inline void Job::AddRequire (impl::IComponentAccess* access) {
-    access->ApplyTo(m_required);
+    access->ApplyTo(m_filter.m_required);
 }
 
 inline void Job::AddRequireAny (impl::IComponentAccess* access) {
     impl::ComponentFlags any;
     access->ApplyTo(any);
-    m_requireAny.push_back(any);
+    m_filter.m_requireAny.push_back(any);
 }
 
 inline void Job::AddWrite (impl::IComponentAccess* access) {
     access->ApplyTo(m_write);
-    access->ApplyTo(m_required);
+    access->ApplyTo(m_filter.m_required);
     m_dataAccess.push_back(access);
 }
 
@@ -54,6 +70,15 @@ inline void Job::ApplyQueuedCommands () {
     m_commands.Apply(m_manager);
 }
 
+// - Applies the commands queued by every parallel instance in the order of the
+//   blocks they were queued from, no matter which worker ran each block
+// - That is the order RunJob queues them in, and entities reserved by each block come from
+//   the same ranges RunJob uses, so results match it for any thread count
+inline void Job::ApplyParallelQueuedCommands () {
+    m_parallelCommands.MergeFrom(m_parallelQueues.data(), (uint32_t)m_parallelQueues.size());
+    m_parallelCommands.Apply(m_manager);
+}
+
 inline bool Job::HasQueuedCommands () const {
     return !m_commands.IsEmpty();
 }
@@ -68,8 +93,27 @@ inline const impl::ComponentFlags& Job::GetWriteFlags () const {
 
 // - Call inside ForEachChunk to get the size of component arrays in that chunk
 inline uint32_t Job::GetChunkEntityCount () const {
-    assert(m_chunkIndex < m_chunks.size()); // Don't call this outside ForEachChunk or ForEach
-    return m_chunks[m_chunkIndex]->GetCount();
+    assert(m_chunk); // Don't call this outside ForEachChunk or ForEach
+    return m_chunk->GetBlockEntityCount(m_blockIndex);
+}
+
+// - Call inside ForEachChunk to get the size of component arrays rounded up to ECS_CHUNK_LANE_COUNT
+// - Entries past GetChunkEntityCount are scratch space for trivially copyable components
+//     - Safe to load and store in whole vectors, but they are not entities and their values are never kept
+//     - Other components have no objects there, don't touch them
+inline uint32_t Job::GetChunkPaddedEntityCount () const {
+    assert(m_chunk); // Don't call this outside ForEachChunk or ForEach
+    return m_chunk->GetBlockPaddedEntityCount(m_blockIndex);
+}
+
+template<typename T>
+inline T* Job::FindOtherForWrite (Entity entity) {
+    return m_manager->template FindComponentInternal<T>(entity, m_runVersion);
+}
+
+// - False for chunks that ECS_CHANGED filters skip this run
+inline bool Job::HasChanged (const impl::Chunk* chunk) const {
+    return m_changed.IsEmpty() || chunk->HasChangedSince(m_changed, m_lastRunVersion);
 }
 
 // - Use to check existance of a component on an Entity
@@ -78,94 +122,239 @@ inline bool Job::HasComponent (Entity entity) const {
     return m_manager->HasComponent<T>(entity);
 }
 
-inline void Job::OnChunkAdded (impl::Chunk* chunk) {
-    if (!IsValid(chunk))
-        return;
-    m_chunks.push_back(chunk);
-}
-
 inline void Job::OnRegistered (Manager* manager) {
     m_manager = manager;
-    m_chunks.clear();
 
-    // Jobs always ignore prefab entities
-    m_exclude.SetFlags<impl::PrefabComponent>();
+    // Jobs are constructed before they know their Manager, switch
+    // their storage over to the Manager's memory resource
+    impl::Reconstruct(m_commands, manager->GetMemoryResource());
+    impl::Reconstruct(m_parallelCommands, manager->GetMemoryResource());
+    impl::Reconstruct(m_work, manager->GetMemoryResource());
+    impl::Reconstruct(m_workFinished, manager->GetMemoryResource());
+    impl::Reconstruct(m_lastReservations, manager->GetMemoryResource());
 
     for (auto singletonAccess : m_singletonAccess)
         singletonAccess->UpdateManager();
+
+    m_query = manager->GetQueryInternal(m_filter, m_filter.m_required);
 }
 
-inline bool Job::IsValid (const impl::Chunk* chunk) const {
-    const auto& componentFlags = chunk->GetComponentFlags();
-    if (!componentFlags.HasAll(m_required))
-        return false;
-    if (!componentFlags.HasNone(m_exclude))
-        return false;
-    for (const auto& any : m_requireAny) {
-        if (!componentFlags.HasAny(any))
-            return false;
-    }
-    return true;
+// - Parallel instances share the primary's version, so their writes are stamped the same
+inline void Job::OnRunStarted (uint32_t version) {
+    m_runVersion = version;
+    for (Job* instance : m_parallelInstances)
+        instance->m_runVersion = version;
+}
+
+inline void Job::OnRunFinished () {
+    m_lastRunVersion = m_runVersion;
 }
 
 // - Override to do work before and after ForEachChunk or ForEach are run
 // - Make sure to call Job::Run(dt) when you want ForEachChunk and ForEach to run
 inline void Job::Run () {
-    for (m_chunkIndex = 0; m_chunkIndex < m_chunks.size(); ++m_chunkIndex) {
-        impl::Chunk* chunk = m_chunks[m_chunkIndex];
-        if (chunk->GetCount() == 0)
+    BeginWork();
+    for (uint32_t i = 0; i < (uint32_t)m_work.size(); ++i)
+        RunWork(i);
+    m_chunk = nullptr;
+    FinishWork();
+}
+
+// - Runs blocks of the primary job's work list until there are none left
+inline void Job::RunParallelWorker (void* instance) {
+    Job* job = static_cast<Job*>(instance);
+    Job* primary = job->m_parallelPrimary;
+    const uint32_t workCount = (uint32_t)primary->m_work.size();
+
+    for (uint32_t i = primary->m_parallelNextWork++; i < workCount; i = primary->m_parallelNextWork++) {
+        // Each worker records into its own queue, tagged with the block so they can be merged in order
+        job->m_commands.BeginSegment(i);
+        job->RunWork(i);
+    }
+    job->m_chunk = nullptr;
+}
+
+// - Lists the blocks of every chunk this run visits, and sets aside a range of
+//   entity reservations for each, sized by how many that block reserved last run
+inline void Job::BeginWork () {
+    m_work.clear();
+    uint32_t reservations = 0;
+    for (impl::Chunk* chunk : m_query->m_chunks) {
+        if (!HasChanged(chunk))
             continue;
-        for (auto dataAccess : m_dataAccess)
-            dataAccess->UpdateChunk(chunk);
-        ForEachChunk();
+
+        auto last = m_lastReservations.end();
+        if (!m_lastReservations.empty())
+            last = std::lower_bound(m_lastReservations.begin(), m_lastReservations.end(), impl::BlockReservations{ chunk, 0, 0 });
+
+        for (uint32_t block = 0; block < chunk->GetBlockCount(); ++block) {
+            uint32_t count = 0;
+            if (last != m_lastReservations.end() && last->chunk == chunk && last->block == block)
+                count = (last++)->count;
+            m_work.push_back(impl::ChunkBlock{ chunk, block, reservations, count, 0 });
+            reservations += count;
+        }
     }
+    m_reservationTotal = reservations;
+
+    if (m_workFinished.size() < m_work.size())
+        impl::Reconstruct(m_workFinished, m_work.size(), m_manager->GetMemoryResource());
+    for (uint32_t i = 0; i < (uint32_t)m_work.size(); ++i)
+        m_workFinished[i].store(0, std::memory_order_relaxed);
+    m_workFinishedThrough.store(0, std::memory_order_relaxed);
+}
+
+// - Runs a block of the primary job's work list
+inline void Job::RunWork (uint32_t index) {
+    Job* primary = m_parallelPrimary;
+    m_workIndex = index;
+    RunBlock(primary->m_work[index].chunk, primary->m_work[index].block);
+    m_workIndex = UINT32_MAX;
+    primary->m_workFinished[index].store(1, std::memory_order_release);
+}
+
+// - Hands the reservations that no block used back to the Manager
+// - The end of the ranges is given back right away if nothing was reserved after it,
+//   the rest are queued to return to the free list when the commands are applied
+inline void Job::FinishWork () {
+    m_lastReservations.clear();
+    for (const impl::ChunkBlock& work : m_work) {
+        if (work.reserved > 0)
+            m_lastReservations.push_back(impl::BlockReservations{ work.chunk, work.block, work.reserved });
+    }
+    std::sort(m_lastReservations.begin(), m_lastReservations.end());
+
+    const uint32_t base = m_reservationBase.load(std::memory_order_relaxed);
+    if (base == UINT32_MAX)
+        return;
+    m_reservationBase.store(UINT32_MAX, std::memory_order_relaxed);
+
+    uint32_t usedEnd = 0;
+    uint32_t usedCount = 0;
+    for (const impl::ChunkBlock& work : m_work) {
+        if (work.reserved == 0)
+            continue;
+        const uint32_t used = std::min(work.reserved, work.reservationCount);
+        usedEnd = work.firstReservation + used;
+        usedCount += used;
+    }
+
+    const uint32_t end = m_manager->TrimReservationsInternal(base + m_reservationTotal, base + usedEnd) ? usedEnd : m_reservationTotal;
+    if (end == usedCount)
+        return;
+
+    Entity* released = m_commands.ReleaseEntities(end - usedCount);
+    for (const impl::ChunkBlock& work : m_work) {
+        const uint32_t unusedEnd = std::min(work.firstReservation + work.reservationCount, end);
+        for (uint32_t i = work.firstReservation + std::min(work.reserved, work.reservationCount); i < unusedEnd; ++i)
+            *released++ = m_manager->GetReservedEntityInternal(base + i);
+    }
+}
+
+// - Entities reserved inside a block come from its range, they are the same whichever thread runs it
+inline void Job::ReserveEntities (Entity* outEntities, uint32_t count) {
+    if (m_workIndex == UINT32_MAX) {
+        m_manager->ReserveEntitiesInternal(outEntities, count);
+        return;
+    }
+
+    Job* primary = m_parallelPrimary;
+    impl::ChunkBlock& work = primary->m_work[m_workIndex];
+    const uint32_t base = primary->GetReservationBase();
+    uint32_t i = 0;
+    for (; i < count && work.reserved < work.reservationCount; ++i, ++work.reserved)
+        outEntities[i] = m_manager->GetReservedEntityInternal(base + work.firstReservation + work.reserved);
+
+    // Past the end of the range, reserve the rest after every earlier block has
+    if (i < count) {
+        primary->WaitForEarlierWork(m_workIndex);
+        m_manager->ReserveEntitiesInternal(outEntities + i, count - i);
+        work.reserved += count - i;
+    }
+}
+
+// - Claims the ranges for every block of the run the first time one of them is needed
+inline uint32_t Job::GetReservationBase () {
+    uint32_t base = m_reservationBase.load(std::memory_order_acquire);
+    if (base == UINT32_MAX) {
+        std::lock_guard<std::mutex> lock(m_reservationMutex);
+        base = m_reservationBase.load(std::memory_order_relaxed);
+        if (base == UINT32_MAX) {
+            base = m_manager->ClaimReservationsInternal(m_reservationTotal);
+            m_reservationBase.store(base, std::memory_order_release);
+        }
+    }
+    return base;
+}
+
+// - Blocks before this one were handed out first, so they are already running or done
+inline void Job::WaitForEarlierWork (uint32_t index) {
+    uint32_t through = m_workFinishedThrough.load(std::memory_order_acquire);
+    while (through < index) {
+        if (m_workFinished[through].load(std::memory_order_acquire))
+            ++through;
+        else
+            std::this_thread::yield();
+    }
+
+    uint32_t known = m_workFinishedThrough.load(std::memory_order_relaxed);
+    while (known < through && !m_workFinishedThrough.compare_exchange_weak(known, through, std::memory_order_acq_rel, std::memory_order_relaxed)) {}
+}
+
+inline void Job::RunBlock (impl::Chunk* chunk, uint32_t block) {
+    m_chunk = chunk;
+    m_blockIndex = block;
+    for (auto dataAccess : m_dataAccess)
+        dataAccess->UpdateChunk(chunk, block);
+    ForEachChunk();
 }
 
 // - Override to do batch work on contiguous arrays of entities
+// - Called once per block of a chunk, large chunks are split across several calls
 // - Use GetChunkEntityCount() to get the size of the arrays
 // - Use GetChunkComponentArray<T>() on READ/WRITE accessors to get the head of compoennt arrays
 inline void Job::ForEachChunk () {
-    impl::Chunk* chunk = m_chunks[m_chunkIndex];
-    for (m_entityIndex = 0; m_entityIndex < chunk->GetCount(); ++m_entityIndex)
+    const uint32_t count = GetChunkEntityCount();
+    for (m_entityIndex = 0; m_entityIndex < count; ++m_entityIndex)
         ForEach();
 }
 
 // - Queues components to be added or set
 // - Specifying no entity will target the most recently acted on entity
 //     - i.e. Use this to change an entity that was just queued to create or spawn
-// - Executed after Run exits if RunJob<T> was used
-// - Executed after all jobs in an UpdateGroup are complete if RunUpdateGroup<T> was used
 template<typename T, typename...Args>
 inline void Job::QueueAddComponents (T component, Args...args) {
     m_commands.AddComponents(Entity(), component, args...);
 }
 
 // - Queues components to be added or set on an entity
-// - Executed after Run exits if RunJob<T> was used
-// - Executed after all jobs in an UpdateGroup are complete if RunUpdateGroup<T> was used
 template<typename T, typename...Args>
 inline void Job::QueueAddComponents (Entity entity, T component, Args...args) {
     m_commands.AddComponents(entity, component, args...);
 }
 
 // - Queues the cloning of an entity
-// - Executed after Run exits if RunJob<T> was used
-// - Executed after all jobs in an UpdateGroup are complete if RunUpdateGroup<T> was used
-inline void Job::QueueCloneEntity (Entity entity) {
-    m_commands.CloneEntity(entity);
+// - Returns the entity it will be, valid right away to queue other commands on or store in components
+//     - Exists returns false and it has no components until the queued commands are executed
+inline Entity Job::QueueCloneEntity (Entity entity) {
+    Entity clone;
+    ReserveEntities(&clone, 1);
+    m_commands.CloneEntity(entity, clone);
+    return clone;
 }
 
 // - Queues the creation of an entity with the specified components
-// - Executed after Run exits if RunJob<T> was used
-// - Executed after all jobs in an UpdateGroup are complete if RunUpdateGroup<T> was used
+// - Returns the entity it will be, valid right away to queue other commands on or store in components
+//     - Exists returns false and it has no components until the queued commands are executed
 template<typename T, typename...Args>
-inline void Job::QueueCreateEntity (T component, Args...args) {
-    m_commands.CreateEntity(component, args...);
+inline Entity Job::QueueCreateEntity (T component, Args...args) {
+    Entity entity;
+    ReserveEntities(&entity, 1);
+    m_commands.CreateEntity(entity, component, args...);
+    return entity;
 }
 
 // - Queues the destruction of an entity
-// - Executed after Run exits if RunJob<T> was used
-// - Executed after all jobs in an UpdateGroup are complete if RunUpdateGroup<T> was used
 inline void Job::QueueDestroyEntity (Entity entity) {
     m_commands.DestroyEntity(entity);
 }
@@ -173,31 +362,47 @@ inline void Job::QueueDestroyEntity (Entity entity) {
 // - Queues the removal of the specified components
 // - Specifying no entity will target the most recently acted on entity
 //     - i.e. Use this to change an entity that was just queued to create or spawn
-// - Executed after Run exits if RunJob<T> was used
-// - Executed after all jobs in an UpdateGroup are complete if RunUpdateGroup<T> was used
 template<typename T, typename...Args>
 inline void Job::QueueRemoveComponents () {
     m_commands.RemoveComponents<T, Args...>(Entity());
 }
 
 // - Queues the removal of the specified components
-// - Executed after Run exits if RunJob<T> was used
-// - Executed after all jobs in an UpdateGroup are complete if RunUpdateGroup<T> was used
 template<typename T, typename...Args>
 inline void Job::QueueRemoveComponents (Entity entity) {
     m_commands.RemoveComponents<T, Args...>(entity);
 }
 
-// - Queues the rspawning of a prefab
-// - Executed after Run exits if RunJob<T> was used
-// - Executed after all jobs in an UpdateGroup are complete if RunUpdateGroup<T> was used
-inline void Job::QueueSpawnPrefab (Prefab prefab) {
-    m_commands.SpawnPrefab(prefab);
+// - Queues the spawning of a prefab
+// - Returns the entity it will be, valid right away to queue other commands on or store in components
+//     - Exists returns false and it has no components until the queued commands are executed
+inline Entity Job::QueueSpawnPrefab (Prefab prefab) {
+    Entity entity;
+    QueueSpawnPrefab(prefab, 1, &entity);
+    return entity;
+}
+
+// - Queues the spawning of count entities from a prefab, spawned together when executed
+// - Writes the entities they will be to outEntities, if it isn't nullptr
+//     - Valid right away to queue other commands on or store in components
+//     - Exists returns false and they have no components until the queued commands are executed
+inline void Job::QueueSpawnPrefab (Prefab prefab, uint32_t count, Entity* outEntities) {
+    Entity* spawned = m_commands.SpawnPrefab(prefab, count);
+    ReserveEntities(spawned, count);
+    if (outEntities)
+        std::copy(spawned, spawned + count, outEntities);
 }
 
-// Registration
 namespace impl {
 
+// BlockReservations
+inline bool BlockReservations::operator< (const BlockReservations& rhs) const {
+    if (chunk != rhs.chunk)
+        return std::less<const Chunk*>()(chunk, rhs.chunk);
+    return block < rhs.block;
+}
+
+// Registration
 struct JobRegistry {
     static impl::JobId RegisterJob ();
 };
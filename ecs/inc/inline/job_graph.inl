@@ -0,0 +1,71 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+namespace ecs {
+namespace impl {
+
+inline JobGraph::JobGraph (Job* const* jobs, const bool* conflicts, uint32_t count, std::pmr::memory_resource* resource)
+    : m_jobs(jobs, jobs + count, resource)
+    , m_dependencyCounts(count, 0, resource)
+    , m_remainingDependencies(count, resource)
+    , m_dependentOffsets(resource)
+    , m_dependents(resource)
+    , m_contexts(resource)
+{
+    // Later jobs depend on earlier ones they conflict with, so conflicting
+    // jobs always run in the order they were given
+    m_dependentOffsets.reserve(count + 1);
+    for (uint32_t i = 0; i < count; ++i) {
+        m_dependentOffsets.push_back((uint32_t)m_dependents.size());
+        for (uint32_t j = i + 1; j < count; ++j) {
+            if (conflicts[i * count + j]) {
+                m_dependents.push_back(j);
+                ++m_dependencyCounts[j];
+            }
+        }
+    }
+    m_dependentOffsets.push_back((uint32_t)m_dependents.size());
+
+    m_contexts.reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
+        m_contexts.push_back(NodeContext{ this, i });
+}
+
+// - Blocks until every job has run, the calling thread helps run them
+// - Called with the Manager's locks held, so the calling thread only runs the graph's own tasks
+inline void JobGraph::Run (Scheduler& scheduler) {
+    m_scheduler = &scheduler;
+
+    for (uint32_t i = 0; i < (uint32_t)m_jobs.size(); ++i)
+        m_remainingDependencies[i] = m_dependencyCounts[i];
+
+    for (uint32_t i = 0; i < (uint32_t)m_jobs.size(); ++i) {
+        if (m_dependencyCounts[i] == 0)
+            Submit(i);
+    }
+
+    scheduler.Wait(m_group, EWaitMode::GroupTasks);
+}
+
+inline void JobGraph::RunNode (void* context) {
+    NodeContext* node = static_cast<NodeContext*>(context);
+    JobGraph* graph = node->graph;
+
+    graph->m_jobs[node->index]->Run();
+
+    // The last dependency to finish releases each dependent
+    for (uint32_t i = graph->m_dependentOffsets[node->index]; i < graph->m_dependentOffsets[node->index + 1]; ++i) {
+        const uint32_t dependent = graph->m_dependents[i];
+        if (graph->m_remainingDependencies[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+            graph->Submit(dependent);
+    }
+}
+
+inline void JobGraph::Submit (uint32_t index) {
+    m_scheduler->Submit(m_group, &JobGraph::RunNode, &m_contexts[index]);
+}
+
+} // namespace impl
+} // namespace ecs
@@ -0,0 +1,28 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+namespace ecs {
+
+namespace impl {
+
+// AsyncJob
+inline AsyncJob::AsyncJob (Manager* manager, Job* job, std::pmr::memory_resource* resource)
+    : manager(manager)
+    , job(job)
+    , dependents(resource)
+    , commands(resource)
+{
+}
+
+} // namespace impl
+
+// JobHandle
+// - True once the job and everything it depends on have run
+// - Its queued commands may not have been applied yet, see Manager->Complete
+inline bool JobHandle::IsDone () const {
+    return !m_async || m_async->done.IsDone();
+}
+
+} // namespace ecs
@@ -0,0 +1,50 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+namespace ecs {
+
+template<typename...Jobs>
+constexpr bool CanMultithread () {
+    constexpr size_t count = sizeof...(Jobs);
+    constexpr auto conflicts = impl::MakeJobConflicts<Jobs...>();
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t j = i + 1; j < count; ++j) {
+            if (conflicts[i * count + j])
+                return false;
+        }
+    }
+    return true;
+}
+
+namespace impl {
+
+template<typename JobA, typename JobB>
+constexpr bool JobsConflict () {
+    static_assert(std::is_base_of<Job, JobA>::value && std::is_base_of<Job, JobB>::value, "Must inherit from Job");
+    return AccessListsConflict<typename JobAccess<JobA>::type, typename JobAccess<JobB>::type>::value;
+}
+
+template<typename JobA, typename...Jobs>
+constexpr std::array<bool, sizeof...(Jobs)> MakeJobConflictsRow () {
+    return {{ (std::is_same<JobA, Jobs>::value || JobsConflict<JobA, Jobs>())... }};
+}
+
+// - A job listed twice conflicts with itself, it can't run twice at the same time
+template<typename...Jobs>
+constexpr std::array<bool, sizeof...(Jobs) * sizeof...(Jobs)> MakeJobConflicts () {
+    constexpr size_t count = sizeof...(Jobs);
+    std::array<bool, count * count> conflicts{};
+    if constexpr (count > 0) {
+        constexpr std::array<bool, count> rows[] = { MakeJobConflictsRow<Jobs, Jobs...>()... };
+        for (size_t i = 0; i < count; ++i) {
+            for (size_t j = 0; j < count; ++j)
+                conflicts[i * count + j] = rows[i][j];
+        }
+    }
+    return conflicts;
+}
+
+} // namespace impl
+} // namespace ecs
@@ -3,6 +3,9 @@
 // License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
 // ----------------------------------------------------------------------------
 
+#include <algorithm>
+#include <functional>
+
 namespace ecs {
 
 // - Adds components to an entity
@@ -17,14 +20,33 @@ inline void Manager::AddComponents (Entity entity, T component, Args...args) {
     std::unique_lock<std::shared_mutex> lock(m_entityMutex);
 
     auto& entityData = m_entityData[entity.index];
-    m_scratchComposition = entityData.chunk->GetComposition();
-
-    m_scratchComposition.SetComponents(component, args...);
+    impl::Chunk* chunk = GetAddTransitionInternal(entityData.chunk, component, args...);
 
-    SetCompositionInternal(entityData, m_scratchComposition);
+    MoveEntityInternal(entityData, chunk);
     SetComponentsInternal(entityData, component, args...);
 }
 
+// - Adds components to every entity that matches the filter
+// - Sets value if the components already exist
+// - Moves whole chunks at a time
+template<typename T, typename...Args>
+inline void Manager::AddComponents (const Filter& filter, T component, Args...args) {
+    static_assert(!std::is_base_of<ISingletonComponent, T>::value, "Singleton components cannot be added to entities");
+    static_assert(!std::is_same<typename std::remove_const<T>::type, ::ecs::Entity>::value, "Do not add Entity as a component");
+
+    std::unique_lock<std::shared_mutex> lock(m_entityMutex);
+
+    // Gather first, moving entities can create chunks
+    GatherChunksInternal(filter, m_scratchChunks);
+
+    for (impl::Chunk* chunk : m_scratchChunks) {
+        impl::Chunk* to = GetAddTransitionInternal(chunk, component, args...);
+        uint32_t count = chunk->GetCount();
+        uint32_t first = to != chunk ? MoveAllEntitiesInternal(chunk, to) : 0;
+        SetComponentsInternal(to, first, count, component, args...);
+    }
+}
+
 
 // - Creates an entity and adds the specified components to it
 template<typename T, typename...Args>
@@ -37,6 +59,7 @@ inline Entity Manager::CreateEntityImmediate (T component, Args...args) {
     // Compile the composition
     m_scratchComposition.Clear();
     m_scratchComposition.SetComponents(component, args...);
+    SetSharedValuesInternal(m_scratchComposition, component, args...);
 
     // Create the entity
     Entity entity = CreateEntityImmediateInternal(m_scratchComposition);
@@ -48,6 +71,134 @@ inline Entity Manager::CreateEntityImmediate (T component, Args...args) {
 }
 
 
+// - Creates count entities that all have the specified components
+// - Much faster than calling CreateEntityImmediate count times
+// - Writes the created entities to outEntities if it isn't nullptr,
+//   which must have room for count entities
+template<typename T, typename...Args>
+inline void Manager::CreateEntitiesImmediate (Entity* outEntities, uint32_t count, T component, Args...args) {
+    static_assert(!std::is_base_of<ISingletonComponent, T>::value, "Singleton components cannot be added to entities");
+    static_assert(!std::is_same<typename std::remove_const<T>::type, ::ecs::Entity>::value, "Do not add Entity as a component");
+
+    if (count == 0)
+        return;
+
+    std::unique_lock<std::shared_mutex> lock(m_entityMutex);
+
+    // Compile the composition, including the Entity component all entities have
+    m_scratchComposition.Clear();
+    m_scratchComposition.SetComponents(Entity{}, component, args...);
+    SetSharedValuesInternal(m_scratchComposition, component, args...);
+
+    // Reserve all the entities in the chunk at once
+    impl::Chunk* chunk = GetOrCreateChunk(m_scratchComposition);
+    uint32_t first = CreateEntitiesImmediateInternal(chunk, count, outEntities);
+
+    // Apply all the components to the chunk's memory
+    SetComponentsInternal(chunk, first, count, component, args...);
+}
+
+
+// - Calls func(T&, Args&...) on every entity that has all of the specified components
+// - Declare components const to read them, func then takes them by const reference
+// - func is inlined into a plain loop over each block's component arrays,
+//   so it's cheaper than a Job when no filters or queued changes are needed
+// - Don't create, destroy, or change the composition of entities from func
+template<typename T, typename...Args, typename Func>
+inline void Manager::ForEach (Func func) {
+    ForEach<T, Args...>(Filter(), func);
+}
+
+// - Calls func(T&, Args&...) on every entity that has all of the specified
+//   components and also matches the filter
+template<typename T, typename...Args, typename Func>
+inline void Manager::ForEach (const Filter& filter, Func func) {
+    impl::ComponentFlags required = filter.m_required;
+    required.SetFlags<typename std::remove_const<T>::type, typename std::remove_const<Args>::type...>();
+
+    std::shared_lock<std::shared_mutex> lock(m_entityMutex);
+    ForEachInternal<T, Args...>(*GetQueryInternal(filter, required), func);
+}
+
+// - Calls func(T&, Args&...) on every entity that matches the query
+// - The query's filter must require every one of the specified components, other than Entity
+template<typename T, typename...Args, typename Func>
+inline void Manager::ForEach (const Query& query, Func func) {
+#ifndef NDEBUG
+    impl::ComponentFlags components = impl::StaticComponentFlags<typename std::remove_const<T>::type, typename std::remove_const<Args>::type...>();
+    components.ClearFlags<Entity>();
+    assert(query.GetFilter().m_required.HasAll(components));
+#endif
+
+    std::shared_lock<std::shared_mutex> lock(m_entityMutex);
+    ForEachInternal<T, Args...>(query, func);
+}
+
+template<typename T, typename...Args, typename Func>
+inline void Manager::ForEachInternal (const Query& query, Func& func) {
+    static_assert(!std::is_empty<T>::value && (true && ... && !std::is_empty<Args>::value), "Tag components have no data to iterate, use Filter::Require");
+    static_assert(!std::is_base_of<ISingletonComponent, T>::value && (true && ... && !std::is_base_of<ISingletonComponent, Args>::value), "Use GetSingletonComponent");
+    static_assert(!std::is_same<T, Entity>::value && (true && ... && !std::is_same<Args, Entity>::value), "Don't write to Entity, use const ecs::Entity");
+    static_assert(!impl::IsSharedComponent<T>::value && (true && ... && !impl::IsSharedComponent<Args>::value), "Shared components have one value per chunk, use a Job with ECS_READ_SHARED");
+
+    // Components that aren't const are recorded as written for ECS_CHANGED
+    const uint32_t changeVersion = m_changeVersion.Next();
+
+    for (impl::Chunk* chunk : query.m_chunks) {
+        if (chunk->GetCount() == 0)
+            continue;
+        MarkWrittenInternal<T>(chunk, changeVersion);
+        (MarkWrittenInternal<Args>(chunk, changeVersion), ...);
+
+        for (uint32_t block = 0; block < chunk->GetBlockCount(); ++block) {
+            const uint32_t first = block * chunk->GetBlockCapacity();
+            ForEachInBlockInternal(func, chunk->GetBlockEntityCount(block),
+                static_cast<T*>(chunk->Find<typename std::remove_const<T>::type>(first)),
+                static_cast<Args*>(chunk->Find<typename std::remove_const<Args>::type>(first))...);
+        }
+    }
+}
+
+template<typename T>
+inline void Manager::MarkWrittenInternal (impl::Chunk* chunk, uint32_t changeVersion) {
+    if (!std::is_const<T>::value)
+        chunk->MarkChanged(impl::GetComponentIndex<T>(), changeVersion);
+}
+
+template<typename Func, typename...Components>
+inline void Manager::ForEachInBlockInternal (Func& func, uint32_t count, Components*...arrays) {
+    for (uint32_t i = 0; i < count; ++i)
+        func(arrays[i]...);
+}
+
+// - Gets the query shared by every job and ForEach call with this filter
+// - Created the first time a filter is used, and kept up to date for the Manager's lifetime
+inline const Query& Manager::GetQuery (const Filter& filter) {
+    std::shared_lock<std::shared_mutex> lock(m_entityMutex);
+    return *GetQueryInternal(filter, filter.m_required);
+}
+
+inline Query* Manager::GetQueryInternal (const Filter& filter, const impl::ComponentFlags& required) {
+    {
+        std::shared_lock<std::shared_mutex> lock(m_queryMutex);
+        if (Query* query = m_queries.Find(filter, required))
+            return query;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_queryMutex);
+
+    // Make sure that the query wasn't created when we released this lock for a few lines
+    if (Query* query = m_queries.Find(filter, required))
+        return query;
+    return m_queries.Create(filter, required, m_chunks);
+}
+
+// - The memory resource that this Manager's storage is allocated from
+inline std::pmr::memory_resource* Manager::GetMemoryResource () const {
+    return m_resource;
+}
+
+
 // - Gets an ISingletonComponent
 // - Guaranteed to exist
 // - One per Manager
@@ -102,11 +253,13 @@ inline bool Manager::HasComponent (Entity entity) {
 // - Pointer is not safe to hold on to and should be considered invalidated by:
 //     - Composition changes to this entity or one with the same composition
 //     - Destruction of this entity or one with the same composition
+// - Writes through the pointer are not seen by ECS_CHANGED, use AddComponents to set a value that is
 template<typename T>
 inline T* Manager::FindComponent (Entity entity) {
     static_assert(!std::is_base_of<ISingletonComponent, T>::value, "Singleton components cannot be exist on entities");
     static_assert(!std::is_same<std::remove_const<T>::type, ::ecs::Entity>::value, "Why are you finding an Entity with that Entity?");
     static_assert(!std::is_empty<T>(), "Use HasComponent for tag components");
+    static_assert(!impl::IsSharedComponent<T>::value, "Use FindSharedComponent for shared components");
 
     if (!Exists(entity))
         return nullptr;
@@ -117,6 +270,37 @@ inline T* Manager::FindComponent (Entity entity) {
     return entityData.chunk->Find<T>(entityData.chunkIndex);
 }
 
+// - Gets a pointer to the value of a shared component for an entity's chunk
+// - nullptr if the entity doesn't have one, or the entity is destroyed
+// - The value is read only, use AddComponents to move the entity to a different value
+// - Pointer stays valid for the lifetime of the Manager
+template<typename T>
+inline const T* Manager::FindSharedComponent (Entity entity) {
+    if (!Exists(entity))
+        return nullptr;
+
+    std::shared_lock<std::shared_mutex> lock(m_entityMutex);
+
+    return m_entityData[entity.index].chunk->FindShared<T>();
+}
+
+// - FindComponent that also records a write to the component for ECS_CHANGED
+template<typename T>
+inline T* Manager::FindComponentInternal (Entity entity, uint32_t changeVersion) {
+    static_assert(!impl::IsSharedComponent<T>::value, "Shared components can't be written, use AddComponents");
+
+    if (!Exists(entity))
+        return nullptr;
+
+    std::shared_lock<std::shared_mutex> lock(m_entityMutex);
+
+    const auto& entityData = m_entityData[entity.index];
+    T* component = entityData.chunk->Find<T>(entityData.chunkIndex);
+    if (component)
+        entityData.chunk->MarkChanged(impl::GetComponentIndex<T>(), changeVersion);
+    return component;
+}
+
 
 // - Removes components from an entity if it has them
 template<typename T, typename...Args>
@@ -130,32 +314,126 @@ inline void Manager::RemoveComponents (Entity entity) {
     std::unique_lock<std::shared_mutex> lock(m_entityMutex);
 
     auto& entityData = m_entityData[entity.index];
-    m_scratchComposition = entityData.chunk->GetComposition();
+    impl::Chunk* chunk = GetRemoveTransitionInternal<T, Args...>(entityData.chunk);
+
+    MoveEntityInternal(entityData, chunk);
+}
+
+// - Removes components from every entity that matches the filter
+// - Moves whole chunks at a time
+template<typename T, typename...Args>
+inline void Manager::RemoveComponents (const Filter& filter) {
+    static_assert(!std::is_base_of<ISingletonComponent, T>::value, "Singleton components cannot exist on entities");
+    static_assert(!std::is_same<typename std::remove_const<T>::type, ::ecs::Entity>::value, "Do not remove Entity as a component");
+
+    std::unique_lock<std::shared_mutex> lock(m_entityMutex);
+
+    // Gather first, moving entities can create chunks
+    GatherChunksInternal(filter, m_scratchChunks);
 
-    m_scratchComposition.RemoveComponents<T, Args...>();
+    for (impl::Chunk* chunk : m_scratchChunks) {
+        impl::Chunk* to = GetRemoveTransitionInternal<T, Args...>(chunk);
+        if (to != chunk)
+            MoveAllEntitiesInternal(chunk, to);
+    }
+}
+
+template<typename T, typename...Args>
+inline impl::Chunk* Manager::GetAddTransitionInternal (impl::Chunk* from, T component, Args...args) {
+    // Repeated transitions are cached on the chunk, so only the first one
+    // needs to build the destination composition
+    // - Not when adding shared components, the destination depends on their values
+    constexpr bool addsShared = (impl::IsSharedComponent<T>::value || ... || impl::IsSharedComponent<Args>::value);
+    const auto& added = impl::StaticComponentFlags<T, Args...>();
+    impl::Chunk* to = addsShared ? nullptr : from->FindAddTransition(added);
+    if (!to) {
+        m_scratchComposition = from->GetComposition();
+        m_scratchComposition.SetComponents(component, args...);
+        SetSharedValuesInternal(m_scratchComposition, component, args...);
+
+        to = GetOrCreateChunk(m_scratchComposition);
+        if (!addsShared)
+            from->SetAddTransition(added, to);
+    }
+    return to;
+}
+
+template<typename T, typename...Args>
+inline impl::Chunk* Manager::GetRemoveTransitionInternal (impl::Chunk* from) {
+    const auto& removed = impl::StaticComponentFlags<T, Args...>();
+    impl::Chunk* to = from->FindRemoveTransition(removed);
+    if (!to) {
+        m_scratchComposition = from->GetComposition();
+        m_scratchComposition.RemoveComponents<T, Args...>();
+
+        to = GetOrCreateChunk(m_scratchComposition);
+        from->SetRemoveTransition(removed, to);
+    }
+    return to;
+}
+
+template<typename T, typename...Args>
+inline typename std::enable_if<!impl::IsSharedComponent<T>::value>::type Manager::SetSharedValuesInternal (impl::Composition& composition, T component, Args...args) {
+    ECS_REF(component);
+    SetSharedValuesInternal(composition, args...);
+}
 
-    SetCompositionInternal(entityData, m_scratchComposition);
+template<typename T, typename...Args>
+inline typename std::enable_if<impl::IsSharedComponent<T>::value>::type Manager::SetSharedValuesInternal (impl::Composition& composition, T component, Args...args) {
+    composition.SetSharedValue(impl::GetComponentIndex<T>(), m_sharedComponents.Intern(component));
+    SetSharedValuesInternal(composition, args...);
 }
 
 template<typename T, typename...Args>
-inline typename std::enable_if<std::is_empty<T>::value == 0>::type Manager::SetComponentsInternal (const impl::EntityData& entity, T component, Args...args) const {
+inline typename std::enable_if<!std::is_empty<T>::value && !impl::IsSharedComponent<T>::value>::type Manager::SetComponentsInternal (impl::Chunk* chunk, uint32_t first, uint32_t count, T component, Args...args) const {
+    static_assert(!std::is_base_of<ISingletonComponent, T>::value, "Singleton components cannot be set on entities");
+    chunk->Fill(first, count, component);
+    SetComponentsInternal(chunk, first, count, args...);
+}
+
+template<typename T, typename...Args>
+inline typename std::enable_if<std::is_empty<T>::value || impl::IsSharedComponent<T>::value>::type Manager::SetComponentsInternal (impl::Chunk* chunk, uint32_t first, uint32_t count, T component, Args...args) const {
+    ECS_REF(component);
+    SetComponentsInternal(chunk, first, count, args...);
+}
+
+template<typename T, typename...Args>
+inline typename std::enable_if<!std::is_empty<T>::value && !impl::IsSharedComponent<T>::value>::type Manager::SetComponentsInternal (const impl::EntityData& entity, T component, Args...args) const {
     static_assert(!std::is_base_of<ISingletonComponent, T>::value, "Singleton components cannot be set on entities");
     *(entity.chunk->Find<T>(entity.chunkIndex)) = component;
+    entity.chunk->MarkChanged(impl::GetComponentIndex<T>());
     SetComponentsInternal(entity, args...);
 }
 
 template<typename T, typename...Args>
-inline typename std::enable_if<std::is_empty<T>::value>::type Manager::SetComponentsInternal (const impl::EntityData& entity, T component, Args...args) const {
+inline typename std::enable_if<std::is_empty<T>::value || impl::IsSharedComponent<T>::value>::type Manager::SetComponentsInternal (const impl::EntityData& entity, T component, Args...args) const {
     ECS_REF(component);
     SetComponentsInternal(entity, args...);
 }
 
-inline Manager::Manager () {
+inline Manager::Manager (std::pmr::memory_resource* resource)
+    : m_resource(resource)
+    , m_blockPool(resource)
+    , m_sharedComponents(resource)
+    , m_entityData(resource)
+    , m_freeList(resource)
+    , m_jobs(resource)
+    , m_chunks(resource)
+    , m_singletonComponents(resource)
+    , m_queries(resource)
+    , m_finishedAsyncJobs(resource)
+    , m_scratchChunks(resource)
+{
 }
 
 inline Manager::~Manager () {
+    if (m_scheduler)
+        m_scheduler->Wait(m_asyncTasks);
+    delete m_scheduler;
+    m_scheduler = nullptr;
+
     for (auto& chunk : m_chunks)
-        delete chunk.second;
+        impl::DeleteObject(m_resource, chunk.second);
     for (auto& job : m_jobs)
         delete job.second;
     for (auto& singleton : m_singletonComponents)
@@ -169,10 +447,15 @@ inline Manager::~Manager () {
 // - Checks if a created entity has been destroyed
 inline bool Manager::Exists (Entity entity) {
     std::shared_lock<std::shared_mutex> lock(m_entityMutex);
+    return ExistsInternal(entity);
+}
 
+// - Reserved entities don't exist until they have been placed in a chunk
+inline bool Manager::ExistsInternal (Entity entity) const {
     if (!entity.generation || m_entityData.size() <= entity.index)
         return false;
-    return m_entityData[entity.index].generation == entity.generation;
+    const impl::EntityData& entityData = m_entityData[entity.index];
+    return entityData.generation == entity.generation && entityData.chunk;
 }
 
 
@@ -184,24 +467,37 @@ inline Entity Manager::Clone (Entity entity) {
 
     std::unique_lock<std::shared_mutex> lock(m_entityMutex);
 
+    // Allocate a new entity for the copy
+    uint32_t entityIndex = AllocateNewEntityInternal();
+    Entity newEntity = Entity{ entityIndex, m_entityData[entityIndex].generation };
+
+    CloneInternal(entity, newEntity);
+
+    // Return the entity handle to the new entity
+    return newEntity;
+}
+
+inline void Manager::CloneInternal (Entity entity, Entity clone) {
     // Use the chunk to actually copy component data
     impl::EntityData& entityData = m_entityData[entity.index];
     uint32_t chunkIndex = entityData.chunk->CloneEntity(entityData.chunkIndex);
 
-    // Allocate a new entity for the entity we just cloned on the chunk
-    uint32_t entityIndex = AllocateNewEntityInternal();
-
     // Point the entity data at the chunk
-    m_entityData[entityIndex].chunk = m_entityData[entity.index].chunk; // Don't use entityData.chunk, it might be invalidated
-    m_entityData[entityIndex].chunkIndex = chunkIndex;
-
-    // Return the entity handle to the new entity
-    Entity newEntity = Entity{ entityIndex, m_entityData[entityIndex].generation };
+    m_entityData[clone.index].chunk = entityData.chunk;
+    m_entityData[clone.index].chunkIndex = chunkIndex;
 
     // Set the entity component before we do, since it was just cloned by the chunk
-    SetComponentsInternal(m_entityData[entityIndex], newEntity);
+    SetComponentsInternal(m_entityData[clone.index], clone);
+}
 
-    return newEntity;
+inline void Manager::CloneReservedInternal (Entity entity, Entity reserved) {
+    std::unique_lock<std::shared_mutex> lock(m_entityMutex);
+    CommitReservedEntitiesInternal();
+
+    if (ExistsInternal(entity))
+        CloneInternal(entity, reserved);
+    else
+        FreeEntityInternal(reserved.index);
 }
 
 
@@ -239,6 +535,36 @@ inline Entity Manager::CreateEntityImmediateInternal (impl::Composition& composi
     return entity;
 }
 
+inline uint32_t Manager::CreateEntitiesImmediateInternal (impl::Chunk* chunk, uint32_t count, Entity* outEntities) {
+    CommitReservedEntitiesInternal();
+    uint32_t first = chunk->AllocateEntities(count);
+
+    // Recycle as many EntityData as we can, and create the rest all at once
+    const uint32_t recycledCount = std::min(count, (uint32_t)m_freeList.size());
+    const uint32_t freeListEnd = (uint32_t)m_freeList.size() - recycledCount;
+    const uint32_t firstNewIndex = (uint32_t)m_entityData.size();
+    m_entityData.resize(m_entityData.size() + count - recycledCount);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t index = i < recycledCount ? m_freeList[freeListEnd + i] : firstNewIndex + i - recycledCount;
+
+        // Assign the chunk data to the EntityData
+        impl::EntityData& entityData = m_entityData[index];
+        entityData.chunkIndex = first + i;
+        entityData.chunk = chunk;
+
+        // Create the entity handle and set the entity component
+        Entity entity = Entity{ index, entityData.generation };
+        *chunk->Find<Entity>(first + i) = entity;
+
+        if (outEntities)
+            outEntities[i] = entity;
+    }
+    m_freeList.resize(freeListEnd);
+
+    return first;
+}
+
 // - Creates a composition with default values
 // - Create an entity from this prefab by calling SpawnPrefab(Prefab)
 template<typename T, typename...Args>
@@ -265,12 +591,162 @@ inline void Manager::DestroyImmediate (Entity entity) {
     if (swappedEntity)
         m_entityData[swappedEntity->index].chunkIndex = data.chunkIndex;
 
-    if (--m_entityData[entity.index].generation)
-        m_freeList.push_back(entity.index);
+    FreeEntityInternal(entity.index);
+}
+
+// - Destroys every entity that matches the filter
+// - Clears whole chunks at a time
+inline void Manager::DestroyImmediate (const Filter& filter) {
+    std::unique_lock<std::shared_mutex> lock(m_entityMutex);
+
+    GatherChunksInternal(filter, m_scratchChunks);
+
+    for (impl::Chunk* chunk : m_scratchChunks) {
+        for (uint32_t block = 0; block < chunk->GetBlockCount(); ++block) {
+            const Entity* entities = chunk->Find<Entity>(block * chunk->GetBlockCapacity());
+            for (uint32_t i = 0; i < chunk->GetBlockEntityCount(block); ++i)
+                FreeEntityInternal(entities[i].index);
+        }
+        chunk->RemoveAllEntities();
+    }
+}
+
+inline void Manager::FreeEntityInternal (uint32_t index) {
+    CommitReservedEntitiesInternal();
+
+    // Generations count down, an entity that has used them all up is never recycled
+    m_entityData[index].chunk = nullptr;
+    if (--m_entityData[index].generation)
+        m_freeList.push_back(index);
+}
+
+inline void Manager::GatherChunksInternal (const Filter& filter, std::pmr::vector<impl::Chunk*>& chunks) {
+    chunks.clear();
+    for (const auto& chunkIter : m_chunks) {
+        impl::Chunk* chunk = chunkIter.second;
+        if (chunk->GetCount() > 0 && filter.Matches(chunk->GetComponentFlags()))
+            chunks.push_back(chunk);
+    }
 }
 
 
+inline void Manager::ApplyPendingChangesInternal (impl::CommandQueue& queue) {
+    auto& entities = queue.m_pendingEntities;
+    auto& changes = queue.m_pendingChanges;
+    auto& order = queue.m_pendingOrder;
+    auto& batches = queue.m_pendingBatches;
+    auto& chunkIndices = queue.m_pendingChunkIndices;
+
+    std::unique_lock<std::shared_mutex> lock(m_entityMutex);
+    CommitReservedEntitiesInternal();
+
+    // Group each entity's changes together, keeping the order they were queued in
+    std::stable_sort(changes.begin(), changes.end(), [](const impl::PendingChange& lhs, const impl::PendingChange& rhs) {
+        return lhs.pendingEntity < rhs.pendingEntity;
+    });
+
+    // Work out the chunk each entity ends up in
+    auto change = changes.begin();
+    for (uint32_t i = 0; i < (uint32_t)entities.size(); ++i) {
+        impl::PendingEntity& pending = entities[i];
+        const bool exists = pending.create ? !pending.destroyed : ExistsInternal(pending.entity);
+        if (pending.create && pending.destroyed)
+            FreeEntityInternal(pending.entity.index);
+        else if (pending.create) {
+            m_scratchComposition.Clear();
+            m_scratchComposition.SetComponents(Entity{});
+        }
+        else if (exists) {
+            pending.from = m_entityData[pending.entity.index].chunk;
+            m_scratchComposition = pending.from->GetComposition();
+        }
+
+        for (; change != changes.end() && change->pendingEntity == i; ++change) {
+            if (exists)
+                queue.ApplyPendingChangeTo(*change, m_scratchComposition, m_sharedComponents);
+        }
+
+        if (exists)
+            pending.to = pending.from && pending.from->GetComposition() == m_scratchComposition ? pending.from : GetOrCreateChunk(m_scratchComposition);
+    }
+
+    // Batch up entities going between the same two chunks
+    order.clear();
+    for (uint32_t i = 0; i < (uint32_t)entities.size(); ++i) {
+        if (entities[i].to && entities[i].to != entities[i].from)
+            order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&entities](uint32_t lhs, uint32_t rhs) {
+        if (entities[lhs].from != entities[rhs].from)
+            return std::less<impl::Chunk*>()(entities[lhs].from, entities[rhs].from);
+        if (entities[lhs].to != entities[rhs].to)
+            return std::less<impl::Chunk*>()(entities[lhs].to, entities[rhs].to);
+        return lhs < rhs;
+    });
+
+    batches.clear();
+    for (uint32_t i = 0; i < (uint32_t)order.size(); ++i) {
+        if (i == 0 || entities[order[i]].from != entities[order[i - 1]].from || entities[order[i]].to != entities[order[i - 1]].to)
+            batches.push_back(impl::PendingBatch{ i, 0 });
+        batches.back().count++;
+    }
+
+    // Chunk addresses differ between runs, apply batches in the order they were
+    // first queued so entities are placed the same way every time
+    std::sort(batches.begin(), batches.end(), [&order](const impl::PendingBatch& lhs, const impl::PendingBatch& rhs) {
+        return order[lhs.first] < order[rhs.first];
+    });
+
+    for (const auto& batch : batches) {
+        const uint32_t* batchEntities = &order[batch.first];
+        impl::Chunk* from = entities[batchEntities[0]].from;
+        impl::Chunk* to = entities[batchEntities[0]].to;
+
+        // Created entities were reserved when they were queued
+        if (!from) {
+            const uint32_t first = to->AllocateEntities(batch.count);
+            for (uint32_t i = 0; i < batch.count; ++i) {
+                const Entity entity = entities[batchEntities[i]].entity;
+                impl::EntityData& entityData = m_entityData[entity.index];
+                entityData.chunk = to;
+                entityData.chunkIndex = first + i;
+                *to->Find<Entity>(first + i) = entity;
+            }
+            continue;
+        }
+
+        chunkIndices.clear();
+        for (uint32_t i = 0; i < batch.count; ++i)
+            chunkIndices.push_back(m_entityData[entities[batchEntities[i]].entity.index].chunkIndex);
+        std::sort(chunkIndices.begin(), chunkIndices.end(), std::greater<uint32_t>());
+
+        const uint32_t first = from->MoveEntitiesTo(chunkIndices.data(), batch.count, *to);
+
+        // Point the moved entities at their new location, and the entities that
+        // were swapped into the slots they left at theirs
+        for (uint32_t i = 0; i < batch.count; ++i) {
+            impl::EntityData& entityData = m_entityData[to->Find<Entity>(first + i)->index];
+            entityData.chunk = to;
+            entityData.chunkIndex = first + i;
+
+            if (chunkIndices[i] < from->GetCount())
+                m_entityData[from->Find<Entity>(chunkIndices[i])->index].chunkIndex = chunkIndices[i];
+        }
+    }
+
+    // Set the added values, later values for the same component overwrite earlier ones
+    for (const auto& pendingChange : changes) {
+        const impl::PendingEntity& pending = entities[pendingChange.pendingEntity];
+        if (!pending.to)
+            continue;
+        const impl::EntityData& entityData = m_entityData[pending.entity.index];
+        queue.SetPendingValue(pendingChange, entityData.chunk, entityData.chunkIndex);
+    }
+}
+
 inline uint32_t Manager::AllocateNewEntityInternal () {
+    CommitReservedEntitiesInternal();
+
     // Recycle or create a new EntityData
     uint32_t index;
     if (m_freeList.size() > 0) {
@@ -284,10 +760,59 @@ inline uint32_t Manager::AllocateNewEntityInternal () {
     return index;
 }
 
+inline Entity Manager::ReserveEntityInternal () {
+    Entity entity;
+    ReserveEntitiesInternal(&entity, 1);
+    return entity;
+}
+
+inline void Manager::ReserveEntitiesInternal (Entity* outEntities, uint32_t count) {
+    const uint32_t first = ClaimReservationsInternal(count);
+    for (uint32_t i = 0; i < count; ++i)
+        outEntities[i] = GetReservedEntityInternal(first + i);
+}
+
+inline uint32_t Manager::ClaimReservationsInternal (uint32_t count) {
+    return m_reservedEntityCount.fetch_add(count, std::memory_order_relaxed);
+}
+
+inline Entity Manager::GetReservedEntityInternal (uint32_t reservation) const {
+    // Recycle from the back of the free list, the same order AllocateNewEntityInternal does
+    const uint32_t freeCount = (uint32_t)m_freeList.size();
+    if (reservation < freeCount) {
+        const uint32_t index = m_freeList[freeCount - 1 - reservation];
+        return Entity{ index, m_entityData[index].generation };
+    }
+    return Entity{ (uint32_t)m_entityData.size() + reservation - freeCount, impl::EntityData().generation };
+}
+
+inline bool Manager::TrimReservationsInternal (uint32_t end, uint32_t newEnd) {
+    return m_reservedEntityCount.compare_exchange_strong(end, newEnd, std::memory_order_relaxed);
+}
+
+// - They were never handed out, so they keep their generation
+inline void Manager::ReleaseReservedEntitiesInternal (const Entity* entities, uint32_t count) {
+    std::unique_lock<std::shared_mutex> lock(m_entityMutex);
+    CommitReservedEntitiesInternal();
+
+    for (uint32_t i = 0; i < count; ++i)
+        m_freeList.push_back(entities[i].index);
+}
+
+inline void Manager::CommitReservedEntitiesInternal () {
+    const uint32_t count = m_reservedEntityCount.exchange(0, std::memory_order_relaxed);
+    if (count == 0)
+        return;
+
+    const uint32_t recycledCount = std::min(count, (uint32_t)m_freeList.size());
+    m_freeList.resize(m_freeList.size() - recycledCount);
+    m_entityData.resize(m_entityData.size() + count - recycledCount);
+}
+
 inline impl::Chunk* Manager::GetOrCreateChunk (const impl::Composition& composition) {
     auto chunkIter = m_chunks.find(composition);
     if (chunkIter == m_chunks.end()) {
-        m_chunks.emplace(composition, new impl::Chunk(composition));
+        m_chunks.emplace(composition, impl::NewObject<impl::Chunk>(m_resource, composition, &m_blockPool, &m_changeVersion, &m_sharedComponents, m_resource));
         chunkIter = m_chunks.find(composition);
         NotifyChunkCreated(chunkIter->second);
     }
@@ -295,17 +820,317 @@ inline impl::Chunk* Manager::GetOrCreateChunk (const impl::Composition& composit
 }
 
 inline void Manager::NotifyChunkCreated (impl::Chunk* chunk) {
-    std::unique_lock<std::shared_mutex> lock(m_jobMutex);
+    std::unique_lock<std::shared_mutex> lock(m_queryMutex);
+    m_queries.OnChunkCreated(chunk);
+}
 
-    for (const auto& jobIter : m_jobs)
-        jobIter.second->OnChunkAdded(chunk);
+inline void Manager::NotifyChunksDestroyed (const std::pmr::vector<impl::Chunk*>& chunks) {
+    std::unique_lock<std::shared_mutex> lock(m_queryMutex);
+    m_queries.OnChunksDestroyed(chunks);
+}
+
+
+// - Destroys chunks that have had no entities for at least minTimeEmpty
+// - Their blocks are kept by the Manager and reused by chunks created later
+// - Jobs stop visiting pruned chunks, which keeps short-lived compositions
+//   from slowing down every job that matches them
+inline void Manager::PruneUnusedChunks (std::chrono::steady_clock::duration minTimeEmpty) {
+    std::unique_lock<std::shared_mutex> lock(m_entityMutex);
+
+    const auto now = std::chrono::steady_clock::now();
+    m_scratchChunks.clear();
+    for (auto iter = m_chunks.begin(); iter != m_chunks.end();) {
+        impl::Chunk* chunk = iter->second;
+        if (chunk->GetCount() > 0 || now - chunk->GetEmptySince() < minTimeEmpty) {
+            ++iter;
+            continue;
+        }
+        m_scratchChunks.push_back(chunk);
+        iter = m_chunks.erase(iter);
+    }
+
+    if (m_scratchChunks.empty())
+        return;
+
+    std::sort(m_scratchChunks.begin(), m_scratchChunks.end());
+
+    NotifyChunksDestroyed(m_scratchChunks);
+    for (auto& chunk : m_chunks)
+        chunk.second->RemoveTransitionsTo(m_scratchChunks);
+
+    for (impl::Chunk* chunk : m_scratchChunks)
+        impl::DeleteObject(m_resource, chunk);
+    m_scratchChunks.clear();
 }
 
 
 // - Executes a job
+// - Completes any RunJobAsync of the job that is still in flight first
 // - Flushes any queued composition changes after running
 template<typename T>
 inline void Manager::RunJob () {
+    Job* job = GetOrCreateJobInternal<T>();
+    RunJobsInternal(&job, 1);
+}
+
+// - Runs every job of an UpdateGroup in order on this thread
+// - Entity and queued command locks are taken once for the whole group, and
+//   commands queued by its jobs are applied together after the last one finishes
+template<typename T>
+inline void Manager::RunUpdateGroup () {
+    RunUpdateGroupInternal(typename impl::FlattenUpdateGroup<T>::type{});
+}
+
+template<typename...Jobs>
+inline void Manager::RunUpdateGroupInternal (UpdateGroup<Jobs...>) {
+    static_assert(sizeof...(Jobs) > 0, "Update group has no jobs");
+
+    // Look up every job under a single lock, only creating them takes it exclusively
+    Job* jobs[sizeof...(Jobs)] = {};
+    {
+        std::shared_lock<std::shared_mutex> lock(m_jobMutex);
+        const impl::JobId ids[] = { impl::GetJobId<Jobs>()... };
+        for (uint32_t i = 0; i < sizeof...(Jobs); ++i) {
+            auto iter = m_jobs.find(ids[i]);
+            jobs[i] = iter != m_jobs.end() ? iter->second : nullptr;
+        }
+    }
+    uint32_t index = 0;
+    ((jobs[index] = jobs[index] ? jobs[index] : GetOrCreateJobInternal<Jobs>(), ++index), ...);
+
+    RunJobsInternal(jobs, (uint32_t)sizeof...(Jobs));
+}
+
+// - Starts a job on the scheduler and returns without waiting for it
+// - The job starts once every dependency handle is done, and after any earlier async run of the same job
+// - Jobs run at the same time unless one depends on the other, only leave out dependencies
+//   between jobs that don't conflict (see CanMultithread)
+// - Queued commands are applied by Complete, not when the job finishes
+template<typename T, typename...Handles>
+inline JobHandle Manager::RunJobAsync (const Handles&...dependencies) {
+    static_assert((true && ... && std::is_same<Handles, JobHandle>::value), "Dependencies must be JobHandles");
+    const JobHandle* handles[] = { &dependencies..., nullptr };
+    return RunJobAsyncInternal(GetOrCreateJobInternal<T>(), handles, (uint32_t)sizeof...(Handles));
+}
+
+// - Returns a handle that is done once every one of the handles is done
+template<typename...Handles>
+inline JobHandle Manager::CombineJobHandles (const Handles&...handles) {
+    static_assert((true && ... && std::is_same<Handles, JobHandle>::value), "Can only combine JobHandles");
+    const JobHandle* dependencies[] = { &handles..., nullptr };
+    return RunJobAsyncInternal(nullptr, dependencies, (uint32_t)sizeof...(Handles));
+}
+
+// - Blocks until the handle's job, and every job it depends on, has run
+// - The calling thread helps run queued tasks while it waits
+// - Then applies the queued commands of every async job that has finished so far,
+//   in the order they finished
+// - Don't call from inside a job or scheduler task
+inline void Manager::Complete (const JobHandle& handle) {
+    if (handle.m_async)
+        GetScheduler().Wait(handle.m_async->done);
+
+    std::pmr::vector<std::shared_ptr<impl::AsyncJob>> finished(m_resource);
+    {
+        std::lock_guard<std::mutex> lock(m_asyncMutex);
+        finished.swap(m_finishedAsyncJobs);
+    }
+    if (finished.empty())
+        return;
+
+    // Don't allow other jobs to run while we are applying queued commands
+    std::unique_lock<std::shared_mutex> lock(m_queuedCommandMutex);
+    for (const auto& async : finished)
+        async->commands.Apply(this);
+}
+
+inline JobHandle Manager::RunJobAsyncInternal (Job* job, const JobHandle* const* dependencies, uint32_t count) {
+    JobHandle handle;
+    handle.m_async = std::allocate_shared<impl::AsyncJob>(std::pmr::polymorphic_allocator<impl::AsyncJob>(m_resource), this, job, m_resource);
+    GetScheduler().Retain(handle.m_async->done);
+
+    auto addDependency = [&handle](const std::shared_ptr<impl::AsyncJob>& dependency) {
+        if (!dependency)
+            return;
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+        if (dependency->finished)
+            return;
+        dependency->dependents.push_back(handle.m_async);
+        handle.m_async->remainingDependencies.fetch_add(1, std::memory_order_relaxed);
+    };
+
+    for (uint32_t i = 0; i < count; ++i)
+        addDependency(dependencies[i]->m_async);
+    if (job) {
+        std::lock_guard<std::mutex> lock(m_asyncMutex);
+        addDependency(job->m_lastAsync);
+        job->m_lastAsync = handle.m_async;
+    }
+
+    // Drop the reference held while adding dependencies, the last one to finish starts the job
+    if (handle.m_async->remainingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        StartAsyncJobInternal(handle.m_async);
+    return handle;
+}
+
+inline void Manager::StartAsyncJobInternal (const std::shared_ptr<impl::AsyncJob>& async) {
+    // Combined handles have nothing to run
+    if (!async->job) {
+        FinishAsyncJobInternal(async.get());
+        return;
+    }
+    async->self = async;
+    GetScheduler().Submit(m_asyncTasks, &Manager::RunAsyncJobInternal, async.get());
+}
+
+inline void Manager::RunAsyncJobInternal (void* context) {
+    impl::AsyncJob* async = static_cast<impl::AsyncJob*>(context);
+    Manager* mgr = async->manager;
+    Job* job = async->job;
+    {
+        // Don't allow entities changes or queued commands to run while we are running
+        // Same order as applying queued commands, which holds the queued command lock while changing entities
+        std::shared_lock<std::shared_mutex> queuedCommandLock(mgr->m_queuedCommandMutex);
+        std::shared_lock<std::shared_mutex> entityLock(mgr->m_entityMutex);
+        job->OnRunStarted(mgr->m_changeVersion.Next());
+        job->Run();
+        job->OnRunFinished();
+
+        // Hand the commands to the handle, leaving the job's queue empty for its next run
+        if (job->HasQueuedCommands())
+            async->commands.Swap(job->m_commands);
+    }
+    mgr->FinishAsyncJobInternal(async);
+}
+
+inline void Manager::FinishAsyncJobInternal (impl::AsyncJob* async) {
+    std::pmr::vector<std::shared_ptr<impl::AsyncJob>> dependents(m_resource);
+    {
+        std::lock_guard<std::mutex> lock(async->mutex);
+        async->finished = true;
+        dependents.swap(async->dependents);
+    }
+
+    if (!async->commands.IsEmpty()) {
+        std::lock_guard<std::mutex> lock(m_asyncMutex);
+        m_finishedAsyncJobs.push_back(async->self);
+    }
+
+    // Done before any dependent can start, so a finished handle implies its dependencies are too
+    // Nothing may touch async after dropping self, it can be the last reference
+    std::shared_ptr<impl::AsyncJob> self = std::move(async->self);
+    GetScheduler().Release(async->done);
+
+    for (const auto& dependent : dependents) {
+        if (dependent->remainingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            StartAsyncJobInternal(dependent);
+    }
+}
+
+inline void Manager::CompleteAsyncRunsInternal (Job* const* jobs, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        JobHandle last;
+        {
+            std::lock_guard<std::mutex> lock(m_asyncMutex);
+            last.m_async = jobs[i]->m_lastAsync;
+        }
+        if (!last.m_async)
+            continue;
+        Complete(last);
+
+        // Nothing to wait on next time, unless it was run async again meanwhile
+        std::lock_guard<std::mutex> lock(m_asyncMutex);
+        if (jobs[i]->m_lastAsync == last.m_async)
+            jobs[i]->m_lastAsync.reset();
+    }
+}
+
+inline void Manager::RunJobsInternal (Job* const* jobs, uint32_t count) {
+    CompleteAsyncRunsInternal(jobs, count);
+
+    bool hasQueuedCommands = false;
+    {
+        // Don't allow entities changes or queued commands to run while we are running
+        // Same order as applying queued commands, which holds the queued command lock while changing entities
+        std::shared_lock<std::shared_mutex> queuedCommandLock(m_queuedCommandMutex);
+        std::shared_lock<std::shared_mutex> entityLock(m_entityMutex);
+        for (uint32_t i = 0; i < count; ++i) {
+            jobs[i]->OnRunStarted(m_changeVersion.Next());
+            jobs[i]->Run();
+            jobs[i]->OnRunFinished();
+            hasQueuedCommands = hasQueuedCommands || jobs[i]->HasQueuedCommands();
+        }
+    }
+    if (hasQueuedCommands) {
+        // Don't allow other jobs to run while we are applying queued commands
+        std::unique_lock<std::shared_mutex> lock(m_queuedCommandMutex);
+        for (uint32_t i = 0; i < count; ++i)
+            jobs[i]->ApplyQueuedCommands();
+    }
+}
+
+
+// - Sets the thread count and pinning of the scheduler's worker threads
+// - Restarts the threads if the scheduler has already been created,
+//   don't call while parallel jobs or submitted tasks are running
+inline void Manager::ConfigureScheduler (const SchedulerSettings& settings) {
+    std::lock_guard<std::mutex> lock(m_schedulerMutex);
+
+    m_schedulerSettings = settings;
+    if (m_scheduler) {
+        delete m_scheduler;
+        m_scheduler = new Scheduler(m_schedulerSettings, m_resource);
+    }
+}
+
+// - Worker threads shared by parallel jobs, tasks can also be submitted to it directly
+// - Started on first use
+inline Scheduler& Manager::GetScheduler () {
+    std::lock_guard<std::mutex> lock(m_schedulerMutex);
+
+    if (!m_scheduler)
+        m_scheduler = new Scheduler(m_schedulerSettings, m_resource);
+    return *m_scheduler;
+}
+
+
+// - Executes a job with its chunks split across worker threads
+// - Each worker gets its own instance of the job, so per-job member data is per-worker
+// - Completes any RunJobAsync of the job that is still in flight first
+// - Run is not called, ForEachChunk and ForEach are called from multiple threads
+//     - Only write to the entity being iterated, and singletons must not be written
+// - Flushes any queued composition changes from every worker after running, in the
+//   order RunJob would have queued them, so results are the same for any thread count
+template<typename T>
+inline void Manager::RunJobParallel () {
+    Job* job = GetOrCreateJobInternal<T>();
+
+    // One instance per scheduler thread, the calling thread runs the job itself
+    if (job->m_parallelQueues.empty())
+        job->m_parallelQueues.push_back(&job->m_commands);
+    while (job->m_parallelInstances.size() < GetScheduler().GetThreadCount()) {
+        Job* instance = new T();
+        RegisterJobInternal(instance);
+        instance->m_parallelPrimary = job;
+        job->m_parallelInstances.push_back(instance);
+        job->m_parallelQueues.push_back(&instance->m_commands);
+    }
+
+    RunJobParallelInternal(job);
+}
+
+// - Executes a set of jobs on the scheduler's threads
+// - Jobs that access the same components run in the order given, others run at the same time
+// - Flushes queued composition changes from every job after they have all run, in the order given
+template<typename...Jobs>
+inline void Manager::RunJobsMultithreaded () {
+    static constexpr auto s_conflicts = impl::MakeJobConflicts<Jobs...>();
+    Job* jobs[] = { GetOrCreateJobInternal<Jobs>()... };
+    RunJobsMultithreadedInternal(jobs, s_conflicts.data(), (uint32_t)sizeof...(Jobs));
+}
+
+template<typename T>
+inline Job* Manager::GetOrCreateJobInternal () {
     static_assert(std::is_base_of<Job, T>::value, "Must inherit from Job");
 
     Job* job = nullptr;
@@ -331,19 +1156,76 @@ inline void Manager::RunJob () {
             m_jobs.emplace(impl::GetJobId<T>(), job);
         }
     }
+    return job;
+}
+
+inline void Manager::RunJobsMultithreadedInternal (Job* const* jobs, const bool* conflicts, uint32_t count) {
+    CompleteAsyncRunsInternal(jobs, count);
 
     bool hasQueuedCommands = false;
     {
         // Don't allow entities changes or queued commands to run while we are running
+        // Same order as applying queued commands, which holds the queued command lock while changing entities
+        std::shared_lock<std::shared_mutex> queuedCommandLock(m_queuedCommandMutex);
         std::shared_lock<std::shared_mutex> entityLock(m_entityMutex);
+
+        impl::JobGraph graph(jobs, conflicts, count, m_resource);
+        for (uint32_t i = 0; i < count; ++i)
+            jobs[i]->OnRunStarted(m_changeVersion.Next());
+        graph.Run(GetScheduler());
+        for (uint32_t i = 0; i < count; ++i)
+            jobs[i]->OnRunFinished();
+
+        for (uint32_t i = 0; i < count; ++i)
+            hasQueuedCommands = hasQueuedCommands || jobs[i]->HasQueuedCommands();
+    }
+    if (hasQueuedCommands) {
+        // Don't allow other jobs to run while we are applying queued commands
+        std::unique_lock<std::shared_mutex> lock(m_queuedCommandMutex);
+        for (uint32_t i = 0; i < count; ++i)
+            jobs[i]->ApplyQueuedCommands();
+    }
+}
+
+inline void Manager::RunJobParallelInternal (Job* job) {
+    CompleteAsyncRunsInternal(&job, 1);
+
+    bool hasQueuedCommands = false;
+    {
+        // Don't allow entities changes or queued commands to run while we are running
+        // Same order as applying queued commands, which holds the queued command lock while changing entities
         std::shared_lock<std::shared_mutex> queuedCommandLock(m_queuedCommandMutex);
-        job->Run();
+        std::shared_lock<std::shared_mutex> entityLock(m_entityMutex);
+
+        // Work is handed out a block at a time, so large chunks are shared between workers
+        job->OnRunStarted(m_changeVersion.Next());
+
+        job->BeginWork();
+        job->m_parallelNextWork = 0;
+
+        Scheduler& scheduler = GetScheduler();
+        TaskGroup group;
+        const size_t workCount = job->m_work.size();
+        const size_t taskCount = std::min(job->m_parallelInstances.size(), workCount > 0 ? workCount - 1 : 0);
+        for (size_t i = 0; i < taskCount; ++i)
+            scheduler.Submit(group, &Job::RunParallelWorker, job->m_parallelInstances[i]);
+        Job::RunParallelWorker(job);
+        // Other tasks, like async jobs, may take the locks this thread already holds
+        scheduler.Wait(group, EWaitMode::GroupTasks);
+
+        // Unused reservations are released after the commands of every block
+        job->m_commands.BeginSegment(UINT32_MAX);
+        job->FinishWork();
+        job->OnRunFinished();
+
         hasQueuedCommands = job->HasQueuedCommands();
+        for (Job* instance : job->m_parallelInstances)
+            hasQueuedCommands = hasQueuedCommands || instance->HasQueuedCommands();
     }
     if (hasQueuedCommands) {
         // Don't allow other jobs to run while we are applying queued commands
         std::unique_lock<std::shared_mutex> lock(m_queuedCommandMutex);
-        job->ApplyQueuedCommands();
+        job->ApplyParallelQueuedCommands();
     }
 }
 
@@ -352,23 +1234,78 @@ inline void Manager::RunJob () {
 // - Will have all the components and values specified in the prefab
 // - Passing an invalid Prefab will return an invalid Entity
 inline Entity Manager::SpawnPrefab (Prefab prefab) {
-    if (!Exists(prefab.m_entity))
-        return Entity();
+    Entity spawned;
+    SpawnPrefab(prefab, 1, &spawned);
+    return spawned;
+}
 
-    Entity spawned = Clone(prefab.m_entity);
-    RemoveComponents<impl::PrefabComponent>(spawned);
+// - Creates count entities from a prefab, copying its values straight into the chunk they are created in
+// - outEntities can be nullptr, otherwise it must have room for count entities
+// - Passing an invalid Prefab will write invalid Entities
+inline void Manager::SpawnPrefab (Prefab prefab, uint32_t count, Entity* outEntities) {
+    std::unique_lock<std::shared_mutex> lock(m_entityMutex);
 
-    return spawned;
+    if (!ExistsInternal(prefab.m_entity)) {
+        if (outEntities)
+            std::fill_n(outEntities, count, Entity());
+        return;
+    }
+
+    // Entity data can move while entities are created
+    impl::Chunk* from = m_entityData[prefab.m_entity.index].chunk;
+    const uint32_t index = m_entityData[prefab.m_entity.index].chunkIndex;
+
+    // The chunk prefabs spawn into is cached as a transition on the prefab's chunk
+    impl::Chunk* to = GetRemoveTransitionInternal<impl::PrefabComponent>(from);
+    const uint32_t first = CreateEntitiesImmediateInternal(to, count, outEntities);
+    from->CopyEntityTo(index, *to, first, count);
+}
+
+inline void Manager::SpawnPrefabReservedInternal (Entity prefab, const Entity* reserved, uint32_t count) {
+    std::unique_lock<std::shared_mutex> lock(m_entityMutex);
+    CommitReservedEntitiesInternal();
+
+    if (!ExistsInternal(prefab)) {
+        for (uint32_t i = 0; i < count; ++i)
+            FreeEntityInternal(reserved[i].index);
+        return;
+    }
+
+    impl::Chunk* from = m_entityData[prefab.index].chunk;
+    const uint32_t index = m_entityData[prefab.index].chunkIndex;
+
+    impl::Chunk* to = GetRemoveTransitionInternal<impl::PrefabComponent>(from);
+    const uint32_t first = to->AllocateEntities(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        impl::EntityData& entityData = m_entityData[reserved[i].index];
+        entityData.chunk = to;
+        entityData.chunkIndex = first + i;
+        *to->Find<Entity>(first + i) = reserved[i];
+    }
+    from->CopyEntityTo(index, *to, first, count);
+}
+
+inline uint32_t Manager::MoveAllEntitiesInternal (impl::Chunk* from, impl::Chunk* to) {
+    const uint32_t count = from->GetCount();
+    const uint32_t first = from->MoveAllTo(*to);
+
+    // Point all of the moved entities at their new location
+    for (uint32_t i = first; i < first + count; ++i) {
+        impl::EntityData& entityData = m_entityData[to->Find<Entity>(i)->index];
+        entityData.chunk = to;
+        entityData.chunkIndex = i;
+    }
+
+    return first;
 }
 
 inline void Manager::RegisterJobInternal (Job* job) {
+    // Finding the job's query reads the chunks
+    std::shared_lock<std::shared_mutex> lock(m_entityMutex);
     job->OnRegistered(this);
-    for (auto& chunk : m_chunks)
-        job->OnChunkAdded(chunk.second);
 }
 
-inline void Manager::SetCompositionInternal (impl::EntityData& entityData, const impl::Composition& composition) {
-    auto chunk = GetOrCreateChunk(composition);
+inline void Manager::MoveEntityInternal (impl::EntityData& entityData, impl::Chunk* chunk) {
     if (chunk == entityData.chunk)
         return;
 
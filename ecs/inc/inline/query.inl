@@ -0,0 +1,102 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+
+namespace ecs {
+
+// Query
+inline Query::Query (const Filter& filter, std::pmr::memory_resource* resource)
+    : m_filter(filter)
+    , m_chunks(resource)
+{
+}
+
+inline const Filter& Query::GetFilter () const {
+    return m_filter;
+}
+
+namespace impl {
+
+// QueryCache
+inline QueryCache::QueryCache (std::pmr::memory_resource* resource)
+    : m_resource(resource)
+    , m_queries(resource)
+    , m_queriesByComponent(resource)
+    , m_unindexedQueries(resource)
+{
+}
+
+inline QueryCache::~QueryCache () {
+    for (auto& query : m_queries)
+        DeleteObject(m_resource, query.second);
+    m_queries.clear();
+}
+
+inline Query* QueryCache::Find (const Filter& filter, const ComponentFlags& required) const {
+    auto range = m_queries.equal_range(filter.GetHash(required));
+    for (auto iter = range.first; iter != range.second; ++iter) {
+        if (filter.Equals(iter->second->m_filter, required))
+            return iter->second;
+    }
+    return nullptr;
+}
+
+inline Query* QueryCache::Create (const Filter& from, const ComponentFlags& required, const std::pmr::unordered_map<Composition, Chunk*>& chunks) {
+    Query* query = NewObject<Query>(m_resource, from, m_resource);
+    query->m_filter.m_required = required;
+    const Filter& filter = query->m_filter;
+    m_queries.emplace(filter.GetHash(), query);
+
+    ComponentIndex key = 0;
+    bool hasKey = false;
+    for (ComponentIndex index : filter.m_required) {
+        key = index;
+        hasKey = true;
+    }
+    if (hasKey) {
+        // Sized on first use, so Managers that never run jobs don't allocate
+        if (m_queriesByComponent.empty())
+            m_queriesByComponent.resize(ECS_MAX_COMPONENT_TYPES);
+        m_queriesByComponent[key].push_back(query);
+    }
+    else
+        m_unindexedQueries.push_back(query);
+
+    for (const auto& chunkIter : chunks) {
+        if (filter.Matches(chunkIter.second->GetComponentFlags()))
+            query->m_chunks.push_back(chunkIter.second);
+    }
+    return query;
+}
+
+inline void QueryCache::OnChunkCreated (Chunk* chunk) {
+    const ComponentFlags& flags = chunk->GetComponentFlags();
+    for (ComponentIndex index : flags) {
+        if (index >= m_queriesByComponent.size())
+            break;
+        for (Query* query : m_queriesByComponent[index]) {
+            if (query->m_filter.Matches(flags))
+                query->m_chunks.push_back(chunk);
+        }
+    }
+    for (Query* query : m_unindexedQueries) {
+        if (query->m_filter.Matches(flags))
+            query->m_chunks.push_back(chunk);
+    }
+}
+
+inline void QueryCache::OnChunksDestroyed (const std::pmr::vector<Chunk*>& chunks) {
+    for (auto& queryIter : m_queries) {
+        auto& queryChunks = queryIter.second->m_chunks;
+        auto iter = std::remove_if(queryChunks.begin(), queryChunks.end(), [&chunks](Chunk* chunk) {
+            return std::binary_search(chunks.begin(), chunks.end(), chunk);
+        });
+        queryChunks.erase(iter, queryChunks.end());
+    }
+}
+
+} // namespace impl
+} // namespace ecs
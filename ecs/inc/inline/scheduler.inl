@@ -0,0 +1,248 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cassert>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace ecs {
+
+namespace impl {
+
+// Worker index of the current thread, or UINT32_MAX if it isn't one of the scheduler's workers
+struct WorkerIdentity {
+    const Scheduler* scheduler = nullptr;
+    uint32_t index = UINT32_MAX;
+};
+
+inline WorkerIdentity& GetWorkerIdentity () {
+    static thread_local WorkerIdentity s_identity;
+    return s_identity;
+}
+
+// TaskDeque
+// - Starts with room for some tasks, so submitting rarely allocates
+inline TaskDeque::TaskDeque (std::pmr::memory_resource* resource)
+    : m_tasks(64, resource)
+{
+}
+
+inline void TaskDeque::Grow () {
+    std::pmr::vector<Task> tasks(m_tasks.size() * 2, m_tasks.get_allocator());
+    for (size_t i = 0; i < m_count; ++i)
+        tasks[i] = m_tasks[(m_head + i) % m_tasks.size()];
+    m_tasks.swap(tasks);
+    m_head = 0;
+}
+
+inline void TaskDeque::PushBack (const Task& task) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_count == m_tasks.size())
+        Grow();
+    m_tasks[(m_head + m_count) % m_tasks.size()] = task;
+    ++m_count;
+}
+
+inline bool TaskDeque::PopBack (Task& task) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_count == 0)
+        return false;
+    --m_count;
+    task = m_tasks[(m_head + m_count) % m_tasks.size()];
+    return true;
+}
+
+inline bool TaskDeque::PopFront (Task& task) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_count == 0)
+        return false;
+    task = m_tasks[m_head];
+    m_head = (m_head + 1) % m_tasks.size();
+    --m_count;
+    return true;
+}
+
+inline bool TaskDeque::PopGroup (const TaskGroup* group, Task& task) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = m_count; i-- > 0;) {
+        if (m_tasks[(m_head + i) % m_tasks.size()].group != group)
+            continue;
+        task = m_tasks[(m_head + i) % m_tasks.size()];
+
+        // Close the gap, keeping the other tasks in order
+        for (size_t j = i + 1; j < m_count; ++j)
+            m_tasks[(m_head + j - 1) % m_tasks.size()] = m_tasks[(m_head + j) % m_tasks.size()];
+        --m_count;
+        return true;
+    }
+    return false;
+}
+
+template<typename T>
+inline void InvokeTask (void* context) {
+    (*static_cast<T*>(context))();
+}
+
+} // namespace impl
+
+// TaskGroup
+inline bool TaskGroup::IsDone () const {
+    return m_pending.load(std::memory_order_acquire) == 0;
+}
+
+// Scheduler
+// - Task deques are allocated from resource
+inline Scheduler::Scheduler (const SchedulerSettings& settings, std::pmr::memory_resource* resource)
+    : m_resource(resource)
+{
+    const uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    const uint32_t threadCount = settings.threadCount > 0 ? settings.threadCount : hardwareThreads - 1;
+
+    // Always at least one queue, so tasks submitted without workers are run by Wait
+    for (uint32_t i = 0; i < std::max(threadCount, 1u); ++i)
+        m_queues.push_back(impl::NewObject<impl::TaskDeque>(m_resource, m_resource));
+
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        m_threads.emplace_back(&Scheduler::WorkerMain, this, i);
+        if (settings.pinThreads)
+            PinThread(m_threads.back(), i % hardwareThreads);
+    }
+}
+
+inline Scheduler::~Scheduler () {
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+
+    for (auto& thread : m_threads)
+        thread.join();
+    for (auto queue : m_queues)
+        impl::DeleteObject(m_resource, queue);
+}
+
+inline void Scheduler::Execute (const impl::Task& task) {
+    task.function(task.context);
+    task.group->m_pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+// - Number of worker threads, not counting threads that help out by waiting
+inline uint32_t Scheduler::GetThreadCount () const {
+    return (uint32_t)m_threads.size();
+}
+
+inline void Scheduler::PinThread (std::thread& thread, uint32_t core) {
+#if defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(core, &cpuSet);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpuSet);
+#else
+    (void)thread;
+    (void)core;
+#endif
+}
+
+// - Queues a function to be called on a worker thread
+// - context must stay valid until the group is done
+inline void Scheduler::Submit (TaskGroup& group, void (*function)(void* context), void* context) {
+    group.m_pending.fetch_add(1, std::memory_order_relaxed);
+
+    const impl::WorkerIdentity& identity = impl::GetWorkerIdentity();
+    const uint32_t queueIndex = identity.scheduler == this
+        ? identity.index
+        : m_nextQueue.fetch_add(1, std::memory_order_relaxed) % (uint32_t)m_queues.size();
+
+    // Counted before it is pushed so the count never drops below the number of queued tasks
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_queuedCount.fetch_add(1, std::memory_order_release);
+    }
+    m_queues[queueIndex]->PushBack(impl::Task{ function, context, &group });
+    m_wake.notify_one();
+}
+
+// - Queues a callable object to be invoked on a worker thread
+// - The object is not copied and must stay valid until the group is done
+template<typename T>
+inline void Scheduler::Submit (TaskGroup& group, T& function) {
+    Submit(group, &impl::InvokeTask<T>, &function);
+}
+
+// - Starts at queueIndex and steals from the other queues if it is empty
+inline bool Scheduler::TryPop (uint32_t queueIndex, impl::Task& task) {
+    const uint32_t queueCount = (uint32_t)m_queues.size();
+    bool found = m_queues[queueIndex]->PopBack(task);
+    for (uint32_t i = 1; !found && i < queueCount; ++i)
+        found = m_queues[(queueIndex + i) % queueCount]->PopFront(task);
+
+    if (found)
+        m_queuedCount.fetch_sub(1, std::memory_order_acq_rel);
+    return found;
+}
+
+// - Starts at queueIndex and looks through every queue for one of the group's tasks
+inline bool Scheduler::TryPopGroup (uint32_t queueIndex, const TaskGroup* group, impl::Task& task) {
+    const uint32_t queueCount = (uint32_t)m_queues.size();
+    bool found = false;
+    for (uint32_t i = 0; !found && i < queueCount; ++i)
+        found = m_queues[(queueIndex + i) % queueCount]->PopGroup(group, task);
+
+    if (found)
+        m_queuedCount.fetch_sub(1, std::memory_order_acq_rel);
+    return found;
+}
+
+// - Blocks until every task submitted with the group has finished
+// - Runs queued tasks while waiting, which ones depends on mode
+inline void Scheduler::Wait (TaskGroup& group, EWaitMode mode) {
+    const impl::WorkerIdentity& identity = impl::GetWorkerIdentity();
+    uint32_t queueIndex = identity.scheduler == this ? identity.index : 0;
+
+    impl::Task task;
+    while (!group.IsDone()) {
+        const bool found = mode == EWaitMode::GroupTasks
+            ? TryPopGroup(queueIndex, &group, task)
+            : TryPop(queueIndex, task);
+        if (found)
+            Execute(task);
+        else
+            std::this_thread::yield();
+    }
+}
+
+inline void Scheduler::Retain (TaskGroup& group) {
+    group.m_pending.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void Scheduler::Release (TaskGroup& group) {
+    group.m_pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+inline void Scheduler::WorkerMain (uint32_t workerIndex) {
+    impl::GetWorkerIdentity() = impl::WorkerIdentity{ this, workerIndex };
+
+    impl::Task task;
+    while (true) {
+        if (TryPop(workerIndex, task)) {
+            Execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wake.wait(lock, [this]() {
+            return m_stopping || m_queuedCount.load(std::memory_order_acquire) > 0;
+        });
+        if (m_stopping)
+            return;
+    }
+}
+
+} // namespace ecs
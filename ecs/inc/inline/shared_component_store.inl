@@ -0,0 +1,56 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+#include <cassert>
+#include <cstring>
+
+namespace ecs {
+namespace impl {
+
+inline SharedComponentStore::SharedComponentStore (std::pmr::memory_resource* resource)
+    : m_resource(resource)
+    , m_values(resource)
+    , m_lookup(resource)
+{
+}
+
+inline SharedComponentStore::~SharedComponentStore () {
+    for (const Value& value : m_values)
+        m_resource->deallocate(value.data, value.size, value.alignment);
+}
+
+template<typename T>
+inline uint32_t SharedComponentStore::Intern (const T& value) {
+    static_assert(IsSharedComponent<T>::value, "Only components declared with ECS_SHARED_COMPONENT can be shared");
+    static_assert(std::is_trivially_copyable<T>::value, "Shared components must be trivially copyable");
+    return Intern(GetComponentIndex<T>(), &value, sizeof(T), alignof(T));
+}
+
+inline const void* SharedComponentStore::Get (uint32_t valueId) const {
+    assert(valueId < m_values.size());
+    return m_values[valueId].data;
+}
+
+inline uint32_t SharedComponentStore::Intern (ComponentIndex componentIndex, const void* value, size_t size, size_t alignment) {
+    const uint64_t hash = BytesHash(value, size, componentIndex);
+
+    auto range = m_lookup.equal_range(hash);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+        const Value& existing = m_values[iter->second];
+        if (existing.componentIndex == componentIndex && std::memcmp(existing.data, value, size) == 0)
+            return iter->second;
+    }
+
+    void* data = m_resource->allocate(size, alignment);
+    std::memcpy(data, value, size);
+
+    const uint32_t valueId = (uint32_t)m_values.size();
+    m_values.push_back(Value{ componentIndex, size, alignment, data });
+    m_lookup.emplace(hash, valueId);
+    return valueId;
+}
+
+} // namespace impl
+} // namespace ecs
@@ -9,10 +9,20 @@
 #include "entity.h"
 #include "command_queue.h"
 #include "component_access.h"
+#include "filter.h"
+#include "job_handle.h"
+#include "job_signature.h"
 #include "prefab.h"
+#include "query.h"
 #include "helpers/ref.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 namespace ecs {
@@ -25,9 +35,11 @@ typedef uint32_t JobId;
 
 struct IComponentAccess;
 template<typename T> struct SingletonComponentAccess;
+template<typename T, typename...Args> struct Changed;
 template<typename T, typename...Args> struct Exclude;
 template<typename T> struct Read;
 template<typename T> struct ReadOther;
+template<typename T> struct ReadShared;
 template<typename T> struct ReadSingleton;
 template<typename T, typename...Args> struct Require;
 template<typename T, typename...Args> struct RequireAny;
@@ -37,6 +49,27 @@ template<typename T> struct WriteSingleton;
 
 struct JobTree;
 
+// A single block of a chunk, the unit of work handed to workers by RunJobParallel
+struct ChunkBlock {
+    Chunk* chunk;
+    uint32_t block;
+
+    // Range of the run's entity reservations set aside for commands queued by this block
+    uint32_t firstReservation;
+    uint32_t reservationCount;
+    // Reserved so far, can be more than reservationCount
+    uint32_t reserved;
+};
+
+// How many entities a block reserved last run, sizes its range the next run
+struct BlockReservations {
+    Chunk* chunk;
+    uint32_t block;
+    uint32_t count;
+
+    bool operator< (const BlockReservations& rhs) const;
+};
+
 } // namespace impl
 
 // - Create a struct that inherits ecs::Job
@@ -45,14 +78,22 @@ struct JobTree;
 //         - Used to do work before and after per-entity work
 //         - Call Job::Run(dt) to allow the ForEachChunk and ForEach to run
 //     - ForEachChunk
-//         - Used to do batch work on contiguous chunks of entities
+//         - Used to do batch work on contiguous blocks of entities within a chunk
 //         - Call Job::ForEachChunk(dt) to allow ForEach to run
 //     - ForEach
 //         - Used to do work on each entity
 // - Specify your entity filters using the macros from component_access.h
 // - Run manually using Manager->RunJob<JobType>()
+// - Run across worker threads using Manager->RunJobParallel<JobType>()
+// - Check at compile time which jobs can run at the same time using ecs::CanMultithread<JobA, JobB>()
+// - Commands queued with the Queue functions are executed:
+//     - After Run exits if RunJob<T> was used
+//     - After every worker finishes if RunJobParallel<T> was used
+//     - After all jobs in an UpdateGroup are complete if RunUpdateGroup<T> was used
+//     - By Complete on the returned JobHandle if RunJobAsync<T> was used
 struct Job {
     uint32_t GetChunkEntityCount () const;
+    uint32_t GetChunkPaddedEntityCount () const;
 
     template<typename T>
     bool HasComponent (Entity entity) const;
@@ -62,10 +103,10 @@ struct Job {
     template<typename T, typename...Args>
     void QueueAddComponents (Entity entity, T component, Args...args);
 
-    void QueueCloneEntity (Entity entity);
+    Entity QueueCloneEntity (Entity entity);
 
     template<typename T, typename...Args>
-    void QueueCreateEntity (T component, Args...args);
+    Entity QueueCreateEntity (T component, Args...args);
 
     void QueueDestroyEntity (Entity entity);
 
@@ -74,10 +115,11 @@ struct Job {
     template<typename T, typename...Args>
     void QueueRemoveComponents (Entity entity);
 
-    void QueueSpawnPrefab (Prefab prefab);
+    Entity QueueSpawnPrefab (Prefab prefab);
+    void QueueSpawnPrefab (Prefab prefab, uint32_t count, Entity* outEntities);
 
 public:
-    virtual ~Job () {}
+    virtual ~Job ();
 
     virtual void Run ();
     virtual void ForEachChunk ();
@@ -85,23 +127,73 @@ public:
     virtual void ForEach () { }
 
 private:
-    bool IsValid (const impl::Chunk* chunk) const;
+    bool HasChanged (const impl::Chunk* chunk) const;
+    template<typename T>
+    T* FindOtherForWrite (Entity entity);
+    void RunBlock (impl::Chunk* chunk, uint32_t block);
+    static void RunParallelWorker (void* instance);
+
+    void BeginWork ();
+    void RunWork (uint32_t index);
+    void FinishWork ();
+    void ReserveEntities (Entity* outEntities, uint32_t count);
+    uint32_t GetReservationBase ();
+    void WaitForEarlierWork (uint32_t index);
 
 private:
-    uint32_t m_chunkIndex = 0;
+    impl::Chunk* m_chunk = nullptr;
+    uint32_t m_blockIndex = 0;
     uint32_t m_entityIndex = 0;
-    std::vector<impl::Chunk *> m_chunks;
+    // Shared with every other job and ForEach call that has the same filter
+    Query* m_query = nullptr;
+
+    // Extra instances of this job used by RunJobParallel, one per additional worker
+    // - Each has its own accessors, iteration state, and queued commands
+    std::vector<Job*> m_parallelInstances;
+    Job* m_parallelPrimary = this;
+    std::atomic<uint32_t> m_parallelNextWork{ 0 };
+
+    // Blocks this run visits, in the order RunJob visits them
+    std::pmr::vector<impl::ChunkBlock> m_work;
+    std::pmr::vector<std::atomic<uint8_t>> m_workFinished;
+    // Every block before this one is known to have finished
+    std::atomic<uint32_t> m_workFinishedThrough{ 0 };
+    // Block this instance is running, UINT32_MAX outside of blocks
+    uint32_t m_workIndex = UINT32_MAX;
+
+    // - Entities queued to be created are reserved from ranges set aside for each block,
+    //   laid out in block order, so they are the same whichever worker runs the block
+    // - The ranges start at a base claimed the first time anything is reserved
+    // - Blocks that need more than their range wait for the blocks before them to finish
+    std::atomic<uint32_t> m_reservationBase{ UINT32_MAX };
+    uint32_t m_reservationTotal = 0;
+    std::mutex m_reservationMutex;
+    // Blocks that reserved anything last run, sorted so BeginWork can find them
+    std::pmr::vector<impl::BlockReservations> m_lastReservations;
+
+    // Every instance's queue, this job's first, merged into m_parallelCommands in block order
+    std::vector<impl::CommandQueue*> m_parallelQueues;
+    impl::CommandQueue m_parallelCommands;
+
+    // Most recent RunJobAsync of this job, the next one waits on it so runs never overlap
+    // - Guarded by the Manager's async mutex
+    std::shared_ptr<impl::AsyncJob> m_lastAsync;
 
     std::vector<impl::IComponentAccess *> m_dataAccess;
     std::vector<impl::IComponentAccess *> m_singletonAccess;
 
-    std::vector<impl::ComponentFlags> m_requireAny;
-    impl::ComponentFlags m_exclude;
-    impl::ComponentFlags m_required;
+    Filter m_filter;
 
     impl::ComponentFlags m_read;
     impl::ComponentFlags m_write;
 
+    // Components from ECS_CHANGED, and the versions of this run and the last one
+    // - Writes made by this run are stamped with m_runVersion, so the job doesn't
+    //   see its own writes as changes next time
+    impl::ComponentFlags m_changed;
+    uint32_t m_runVersion = 0;
+    uint32_t m_lastRunVersion = 0;
+
     impl::CommandQueue m_commands;
 
     Manager* m_manager = nullptr;
@@ -109,17 +201,23 @@ private:
 private:
     friend class Manager;
     void ApplyQueuedCommands ();
+    void ApplyParallelQueuedCommands ();
     bool HasQueuedCommands () const;
-    void OnChunkAdded (impl::Chunk* chunk);
     void OnRegistered (Manager* manager);
+    void OnRunStarted (uint32_t version);
+    void OnRunFinished ();
 
 private:
+    template<typename T, typename...Args> friend struct impl::Changed;
+    void AddChanged (impl::IComponentAccess* access);
     template<typename T, typename...Args> friend struct impl::Exclude;
     void AddExclude (impl::IComponentAccess* access);
     template<typename T> friend struct impl::Read;
     void AddRead (impl::IComponentAccess* access);
     template<typename T> friend struct impl::ReadOther;
     void AddReadOther (impl::IComponentAccess* access);
+    template<typename T> friend struct impl::ReadShared;
+    void AddReadShared (impl::IComponentAccess* access);
     template<typename T> friend struct impl::SingletonComponentAccess;
     template<typename T> friend struct impl::ReadSingleton;
     void AddReadSingleton (impl::IComponentAccess* access);
@@ -134,6 +232,11 @@ private:
     template<typename T> friend struct impl::WriteSingleton;
     void AddWriteSingleton (impl::IComponentAccess* access);
 
+protected:
+    // Start of the compile-time access signature, each READ/WRITE accessor macro adds to it
+    static impl::AccessList<> __ecsAccess (impl::AccessCounter<0>);
+    friend struct impl::JobAccessor;
+
 private:
     const impl::ComponentFlags& GetReadFlags () const;
     const impl::ComponentFlags& GetWriteFlags () const;
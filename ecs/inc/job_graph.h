@@ -0,0 +1,53 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "scheduler.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace ecs {
+
+struct Job;
+
+namespace impl {
+
+// - Runs a set of jobs on a Scheduler, as many at a time as their accesses allow
+// - A job waits on every earlier job in the set that it conflicts with
+// - conflicts is the count x count table from MakeJobConflicts, worked out at compile time
+// - Jobs that don't conflict run at the same time
+struct JobGraph {
+    JobGraph (Job* const* jobs, const bool* conflicts, uint32_t count, std::pmr::memory_resource* resource);
+
+    void Run (Scheduler& scheduler);
+
+private:
+    struct NodeContext {
+        JobGraph* graph;
+        uint32_t index;
+    };
+
+    static void RunNode (void* context);
+    void Submit (uint32_t index);
+
+private:
+    std::pmr::vector<Job*> m_jobs;
+    std::pmr::vector<uint32_t> m_dependencyCounts;
+    std::pmr::vector<std::atomic<uint32_t>> m_remainingDependencies;
+    // Dependents of job i are m_dependents[m_dependentOffsets[i], m_dependentOffsets[i + 1])
+    std::pmr::vector<uint32_t> m_dependentOffsets;
+    std::pmr::vector<uint32_t> m_dependents;
+    std::pmr::vector<NodeContext> m_contexts;
+
+    Scheduler* m_scheduler = nullptr;
+    TaskGroup m_group;
+};
+
+} // namespace impl
+} // namespace ecs
@@ -0,0 +1,63 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "command_queue.h"
+#include "scheduler.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+namespace ecs {
+
+class Manager;
+struct Job;
+
+namespace impl {
+
+// - One run of a job started with Manager->RunJobAsync, or a set of handles combined into one
+// - Submitted to the scheduler once every dependency has finished
+struct AsyncJob {
+    AsyncJob (Manager* manager, Job* job, std::pmr::memory_resource* resource);
+
+    Manager* manager;
+    // nullptr for combined handles, which finish as soon as their dependencies do
+    Job* job;
+
+    // Retained until the job finishes, so waiting on it also waits on its dependencies
+    TaskGroup done;
+    // Unfinished dependencies, plus one held while the dependencies are being added
+    std::atomic<uint32_t> remainingDependencies{ 1 };
+
+    std::mutex mutex;
+    bool finished = false;
+    std::pmr::vector<std::shared_ptr<AsyncJob>> dependents;
+
+    // Commands the job queued, applied by Manager->Complete
+    CommandQueue commands;
+
+    // Keeps the job alive while it is queued on the scheduler
+    std::shared_ptr<AsyncJob> self;
+};
+
+} // namespace impl
+
+// - Tracks a job started with Manager->RunJobAsync<T>, or handles combined with Manager->CombineJobHandles
+// - Pass to RunJobAsync to start a job once this one finishes, or to Manager->Complete to wait for it
+// - A default constructed handle is always done
+struct JobHandle {
+    bool IsDone () const;
+
+private:
+    friend class Manager;
+    std::shared_ptr<impl::AsyncJob> m_async;
+};
+
+} // namespace ecs
@@ -0,0 +1,95 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+namespace ecs {
+
+// - True if none of the jobs write a component that another one reads or writes
+// - Evaluated at compile time, use in a static_assert to guard a set of jobs meant to run together
+template<typename...Jobs>
+constexpr bool CanMultithread ();
+
+namespace impl {
+
+// The most READ/WRITE accessors (of every kind) a single job can declare
+constexpr uint32_t MAX_JOB_ACCESS_COUNT = 64;
+
+// Compile-time record of one component accessed by a job
+template<typename T> struct ReadAccess {};
+template<typename T> struct WriteAccess {};
+
+template<typename...Accesses>
+struct AccessList {
+    static constexpr uint32_t Count = sizeof...(Accesses);
+};
+
+template<typename List, typename Access>
+struct AppendAccess;
+
+template<typename...Accesses, typename Access>
+struct AppendAccess<AccessList<Accesses...>, Access> {
+    using type = AccessList<Accesses..., Access>;
+};
+
+// Each accessor macro declares an overload of Job::__ecsAccess taking the next
+// counter, the most derived counter always picks the latest overload
+template<uint32_t N>
+struct AccessCounter : AccessCounter<N - 1> {};
+template<>
+struct AccessCounter<0> {};
+
+// Befriended by every job that declares an accessor, so they can be in any access section
+struct JobAccessor {
+    template<typename T>
+    static auto GetAccessList () -> decltype(T::__ecsAccess(AccessCounter<MAX_JOB_ACCESS_COUNT>{}));
+};
+
+// The AccessList of every accessor declared on a job, including those on its bases
+template<typename T>
+struct JobAccess {
+    using type = decltype(JobAccessor::GetAccessList<T>());
+};
+
+template<typename A, typename B>
+struct AccessesConflict : std::false_type {};
+template<typename T, typename U>
+struct AccessesConflict<ReadAccess<T>, WriteAccess<U>> : std::is_same<typename std::remove_const<T>::type, typename std::remove_const<U>::type> {};
+template<typename T, typename U>
+struct AccessesConflict<WriteAccess<T>, ReadAccess<U>> : std::is_same<typename std::remove_const<T>::type, typename std::remove_const<U>::type> {};
+template<typename T, typename U>
+struct AccessesConflict<WriteAccess<T>, WriteAccess<U>> : std::is_same<typename std::remove_const<T>::type, typename std::remove_const<U>::type> {};
+
+template<typename Access, typename List>
+struct AccessConflictsWithList;
+
+template<typename Access, typename...Accesses>
+struct AccessConflictsWithList<Access, AccessList<Accesses...>>
+    : std::bool_constant<(false || ... || AccessesConflict<Access, Accesses>::value)> {};
+
+template<typename ListA, typename ListB>
+struct AccessListsConflict;
+
+template<typename...Accesses, typename ListB>
+struct AccessListsConflict<AccessList<Accesses...>, ListB>
+    : std::bool_constant<(false || ... || AccessConflictsWithList<Accesses, ListB>::value)> {};
+
+// - True if JobA writes something JobB reads or writes, or the other way around
+template<typename JobA, typename JobB>
+constexpr bool JobsConflict ();
+
+template<typename JobA, typename...Jobs>
+constexpr std::array<bool, sizeof...(Jobs)> MakeJobConflictsRow ();
+
+// - Row-major Count x Count table of which jobs conflict with each other
+template<typename...Jobs>
+constexpr std::array<bool, sizeof...(Jobs) * sizeof...(Jobs)> MakeJobConflicts ();
+
+} // namespace impl
+} // namespace ecs
@@ -5,12 +5,24 @@
 
 #pragma once
 
+#include "block_pool.h"
 #include "chunk.h"
 #include "entity.h"
+#include "filter.h"
 #include "job.h"
+#include "job_graph.h"
 #include "prefab.h"
-
+#include "query.h"
+#include "scheduler.h"
+#include "shared_component_store.h"
+#include "update_group.h"
+#include "helpers/memory.h"
+
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <memory_resource>
+#include <mutex>
 #include <shared_mutex>
 #include <unordered_map>
 #include <vector>
@@ -31,11 +43,16 @@ struct EntityData {
 //     - Create/Destroy/Modify Entities
 //     - Lookup Entity components
 //     - Get Singleton components
-//     - Run Jobs
+//     - Run Jobs, or iterate components with a lambda using ForEach
 //     - Create and spawn Prefabs
 // - Recommended usage:
 //     - Create a single, global ecs::Manager (Multiple managers existing is supported)
 //     - Call jobs from a single location so you can see the order in which they execute
+// - Memory:
+//     - Entity storage, chunks, queued commands, and scheduler task queues are allocated from
+//       the memory resource passed to the constructor, which must outlive the Manager
+//     - Jobs and singleton components are allocated with new, once each
+//     - Handles from RunJobAsync are allocated from the resource too, don't keep them past the Manager
 // - Warnings:
 //     - The Manager itself is thread-safe *but*
 //         - Pointers to non-singleton components can be invalidated by actions
@@ -45,8 +62,11 @@ struct EntityData {
 //             - Do not read and write from the same components
 //             - Do not create/destroy/change composition of entities
 class Manager {
+    friend struct Job;
+    friend struct impl::CommandQueue;
+
 public:
-    Manager ();
+    explicit Manager (std::pmr::memory_resource* resource = std::pmr::get_default_resource());
     ~Manager ();
 
 public:
@@ -54,6 +74,8 @@ public:
 
     template<typename T, typename...Args>
     void AddComponents (Entity entity, T component, Args...args);
+    template<typename T, typename...Args>
+    void AddComponents (const Filter& filter, T component, Args...args);
 
     Entity Clone (Entity entity);
 
@@ -62,10 +84,28 @@ public:
     template<typename T, typename...Args>
     Entity CreateEntityImmediate (T component, Args...args);
 
+    template<typename T, typename...Args>
+    void CreateEntitiesImmediate (Entity* outEntities, uint32_t count, T component, Args...args);
+
     template<typename T, typename...Args>
     Prefab CreatePrefab (T component, Args...args);
 
     void DestroyImmediate (Entity entity);
+    void DestroyImmediate (const Filter& filter);
+
+    template<typename T, typename...Args, typename Func>
+    void ForEach (Func func);
+    template<typename T, typename...Args, typename Func>
+    void ForEach (const Filter& filter, Func func);
+    template<typename T, typename...Args, typename Func>
+    void ForEach (const Query& query, Func func);
+
+    void ConfigureScheduler (const SchedulerSettings& settings);
+    Scheduler& GetScheduler ();
+
+    std::pmr::memory_resource* GetMemoryResource () const;
+
+    const Query& GetQuery (const Filter& filter);
 
     template<typename T>
     T* GetSingletonComponent ();
@@ -75,48 +115,170 @@ public:
 
     template<typename T>
     T* FindComponent (Entity entity);
+    template<typename T>
+    const T* FindSharedComponent (Entity entity);
 
     template<typename T, typename...Args>
     void RemoveComponents (Entity entity);
+    template<typename T, typename...Args>
+    void RemoveComponents (const Filter& filter);
+
+    void PruneUnusedChunks (std::chrono::steady_clock::duration minTimeEmpty = std::chrono::steady_clock::duration::zero());
 
     template<typename T>
     void RunJob ();
+    template<typename T>
+    void RunJobParallel ();
+    template<typename...Jobs>
+    void RunJobsMultithreaded ();
+    template<typename T>
+    void RunUpdateGroup ();
+
+    template<typename T, typename...Handles>
+    JobHandle RunJobAsync (const Handles&...dependencies);
+    template<typename...Handles>
+    JobHandle CombineJobHandles (const Handles&...handles);
+    void Complete (const JobHandle& handle);
 
     Entity SpawnPrefab (Prefab prefab);
+    void SpawnPrefab (Prefab prefab, uint32_t count, Entity* outEntities);
 
 private:
-    std::vector<impl::EntityData> m_entityData;
-    std::vector<uint32_t> m_freeList;
-    std::unordered_map<impl::JobId, Job*> m_jobs;
-    std::unordered_map<impl::Composition, impl::Chunk*> m_chunks;
-    std::unordered_map<impl::ComponentId, ISingletonComponent*> m_singletonComponents;
+    std::pmr::memory_resource* m_resource;
+    impl::BlockPool m_blockPool;
+    impl::ChangeVersion m_changeVersion;
+    impl::SharedComponentStore m_sharedComponents;
+
+    std::pmr::vector<impl::EntityData> m_entityData;
+    std::pmr::vector<uint32_t> m_freeList;
+    // Entities reserved by queued commands since they were last committed, taken from
+    // the back of the free list first and then past the end of the entity data
+    std::atomic<uint32_t> m_reservedEntityCount{ 0 };
+    std::pmr::unordered_map<impl::JobId, Job*> m_jobs;
+    std::pmr::unordered_map<impl::Composition, impl::Chunk*> m_chunks;
+    std::pmr::unordered_map<impl::ComponentId, ISingletonComponent*> m_singletonComponents;
+    impl::QueryCache m_queries;
 
     std::shared_mutex m_entityMutex;
     std::shared_mutex m_jobMutex;
+    std::shared_mutex m_queryMutex;
     std::shared_mutex m_queuedCommandMutex;
     std::shared_mutex m_singletonMutex;
 
-    // Used to prevent allocations, since composition contains a std container
+    // Created on first use, so Managers that never go wide don't start threads
+    Scheduler* m_scheduler = nullptr;
+    SchedulerSettings m_schedulerSettings;
+    std::mutex m_schedulerMutex;
+
+    // Every async job queued on the scheduler, the destructor waits on them
+    TaskGroup m_asyncTasks;
+    std::mutex m_asyncMutex;
+    // Finished async jobs whose queued commands haven't been applied by Complete
+    std::pmr::vector<std::shared_ptr<impl::AsyncJob>> m_finishedAsyncJobs;
+
     impl::Composition m_scratchComposition;
+    // Used to prevent allocations when gathering chunks for batch operations
+    std::pmr::vector<impl::Chunk*> m_scratchChunks;
 
 private:
     uint32_t AllocateNewEntityInternal ();
 
+    // - Reserves entities for queued commands to create, any number of jobs can reserve at once
+    // - Entities must not be changing, hold at least a shared lock of m_entityMutex
+    Entity ReserveEntityInternal ();
+    void ReserveEntitiesInternal (Entity* outEntities, uint32_t count);
+    // - Reservations are numbered in the order they were made since the last commit
+    uint32_t ClaimReservationsInternal (uint32_t count);
+    Entity GetReservedEntityInternal (uint32_t reservation) const;
+    // - Gives back the reservations from newEnd to end, if nothing was reserved after them
+    bool TrimReservationsInternal (uint32_t end, uint32_t newEnd);
+    // - Returns reserved entities that were never used to the free list
+    void ReleaseReservedEntitiesInternal (const Entity* entities, uint32_t count);
+    // - Gives reserved entities their entity data, they don't exist until they are placed in a chunk
+    // - Must be done before the free list or entity data change, hold m_entityMutex exclusively
+    void CommitReservedEntitiesInternal ();
+
+    void CloneInternal (Entity entity, Entity clone);
+    // - Clones into a reserved entity, or releases the reservation if entity doesn't exist
+    void CloneReservedInternal (Entity entity, Entity reserved);
+    // - Spawns a prefab into reserved entities, or releases the reservations if it doesn't exist
+    void SpawnPrefabReservedInternal (Entity prefab, const Entity* reserved, uint32_t count);
+
+    // - Applies the adds and removes a command queue gathered for each entity
+    void ApplyPendingChangesInternal (impl::CommandQueue& queue);
+
     Entity CreateEntityImmediateInternal (impl::Composition& composition);
+    uint32_t CreateEntitiesImmediateInternal (impl::Chunk* chunk, uint32_t count, Entity* outEntities);
+
+    template<typename T, typename...Args, typename Func>
+    void ForEachInternal (const Query& query, Func& func);
+    template<typename T>
+    static void MarkWrittenInternal (impl::Chunk* chunk, uint32_t changeVersion);
+    template<typename Func, typename...Components>
+    static void ForEachInBlockInternal (Func& func, uint32_t count, Components*...arrays);
+
+    // - Entities must not be changing, hold at least a shared lock of m_entityMutex
+    bool ExistsInternal (Entity entity) const;
+
+    template<typename T>
+    T* FindComponentInternal (Entity entity, uint32_t changeVersion);
+
+    void FreeEntityInternal (uint32_t index);
+
+    void GatherChunksInternal (const Filter& filter, std::pmr::vector<impl::Chunk*>& chunks);
+
+    template<typename T, typename...Args>
+    impl::Chunk* GetAddTransitionInternal (impl::Chunk* from, T component, Args...args);
+    template<typename T, typename...Args>
+    impl::Chunk* GetRemoveTransitionInternal (impl::Chunk* from);
 
     impl::Chunk* GetOrCreateChunk (const impl::Composition& composition);
 
+    template<typename T>
+    Job* GetOrCreateJobInternal ();
+
+    // - Entities must not be changing, hold at least a shared lock of m_entityMutex
+    // - The query for filter with required in place of its required components
+    Query* GetQueryInternal (const Filter& filter, const impl::ComponentFlags& required);
+
     void NotifyChunkCreated (impl::Chunk* chunk);
+    void NotifyChunksDestroyed (const std::pmr::vector<impl::Chunk*>& chunks);
+
+    // Interns the values of shared components into the composition
+    void SetSharedValuesInternal (impl::Composition&) {}
+    template<typename T, typename...Args>
+    typename std::enable_if<!impl::IsSharedComponent<T>::value>::type SetSharedValuesInternal (impl::Composition& composition, T component, Args...args);
+    template<typename T, typename...Args>
+    typename std::enable_if<impl::IsSharedComponent<T>::value>::type SetSharedValuesInternal (impl::Composition& composition, T component, Args...args);
+
+    void SetComponentsInternal (impl::Chunk*, uint32_t, uint32_t) const {}
+    template<typename T, typename...Args>
+    typename std::enable_if<!std::is_empty<T>::value && !impl::IsSharedComponent<T>::value>::type SetComponentsInternal (impl::Chunk* chunk, uint32_t first, uint32_t count, T component, Args...args) const;
+    template<typename T, typename...Args>
+    typename std::enable_if<std::is_empty<T>::value || impl::IsSharedComponent<T>::value>::type SetComponentsInternal (impl::Chunk* chunk, uint32_t first, uint32_t count, T component, Args...args) const;
 
     void SetComponentsInternal (const impl::EntityData&) const {}
     template<typename T, typename...Args>
-    typename std::enable_if<std::is_empty<T>::value == 0>::type SetComponentsInternal (const impl::EntityData& entity, T component, Args...args) const;
+    typename std::enable_if<!std::is_empty<T>::value && !impl::IsSharedComponent<T>::value>::type SetComponentsInternal (const impl::EntityData& entity, T component, Args...args) const;
     template<typename T, typename...Args>
-    typename std::enable_if<std::is_empty<T>::value>::type SetComponentsInternal (const impl::EntityData& entity, T component, Args...args) const;
+    typename std::enable_if<std::is_empty<T>::value || impl::IsSharedComponent<T>::value>::type SetComponentsInternal (const impl::EntityData& entity, T component, Args...args) const;
 
-    void SetCompositionInternal (impl::EntityData& entityData, const impl::Composition& composition);
+    void MoveEntityInternal (impl::EntityData& entityData, impl::Chunk* chunk);
+    uint32_t MoveAllEntitiesInternal (impl::Chunk* from, impl::Chunk* to);
 
     void RegisterJobInternal (Job* job);
+    template<typename...Jobs>
+    void RunUpdateGroupInternal (UpdateGroup<Jobs...>);
+    void RunJobsInternal (Job* const* jobs, uint32_t count);
+
+    JobHandle RunJobAsyncInternal (Job* job, const JobHandle* const* dependencies, uint32_t count);
+    void StartAsyncJobInternal (const std::shared_ptr<impl::AsyncJob>& async);
+    static void RunAsyncJobInternal (void* context);
+    void FinishAsyncJobInternal (impl::AsyncJob* async);
+    // - Completes the latest RunJobAsync of each job, so it doesn't run again while one is in flight
+    void CompleteAsyncRunsInternal (Job* const* jobs, uint32_t count);
+    void RunJobParallelInternal (Job* job);
+    void RunJobsMultithreadedInternal (Job* const* jobs, const bool* conflicts, uint32_t count);
 };
 
 } // namespace ecs
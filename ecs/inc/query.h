@@ -0,0 +1,70 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "chunk.h"
+#include "composition.h"
+#include "filter.h"
+#include "helpers/memory.h"
+
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+namespace ecs {
+
+class Manager;
+struct Job;
+
+// - The chunks that match a Filter, kept up to date as chunks are created and destroyed
+// - Shared by every job and ForEach call with an equal filter, so matching is only done once
+// - Get one with Manager::GetQuery, it lives as long as the Manager
+struct Query {
+    Query (const Filter& filter, std::pmr::memory_resource* resource);
+
+    const Filter& GetFilter () const;
+
+private:
+    Filter m_filter;
+    std::pmr::vector<impl::Chunk*> m_chunks;
+
+    friend class Manager;
+    friend struct Job;
+    friend struct impl::QueryCache;
+};
+
+namespace impl {
+
+// - Owns a Manager's queries, one per distinct filter
+// - Queries are indexed by one of their required components, so a new chunk is
+//   only tested against queries that require a component it has
+struct QueryCache {
+    explicit QueryCache (std::pmr::memory_resource* resource);
+    ~QueryCache ();
+
+    // - Finds or creates the query for filter with required in place of its required components,
+    //   so callers that add components don't need to copy the filter
+    Query* Find (const Filter& filter, const ComponentFlags& required) const;
+    // - chunks are every existing chunk, the new query is matched against them
+    Query* Create (const Filter& filter, const ComponentFlags& required, const std::pmr::unordered_map<Composition, Chunk*>& chunks);
+
+    void OnChunkCreated (Chunk* chunk);
+    // - chunks must be sorted
+    void OnChunksDestroyed (const std::pmr::vector<Chunk*>& chunks);
+
+private:
+    std::pmr::memory_resource* m_resource;
+
+    // Keyed by the filter's hash
+    std::pmr::unordered_multimap<size_t, Query*> m_queries;
+    // Indexed by ComponentIndex, each query is in the list of its highest required component
+    std::pmr::vector<std::pmr::vector<Query*>> m_queriesByComponent;
+    // Queries that require nothing, tested against every chunk
+    std::pmr::vector<Query*> m_unindexedQueries;
+};
+
+} // namespace impl
+} // namespace ecs
@@ -0,0 +1,126 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "helpers/memory.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ecs {
+
+class Scheduler;
+
+struct SchedulerSettings {
+    // Number of worker threads, 0 uses one less than the hardware thread count
+    // since the thread waiting on work helps run it
+    uint32_t threadCount = 0;
+    // Pins each worker thread to its own core (Linux only)
+    bool pinThreads = false;
+};
+
+// - Which queued tasks a thread waiting on a TaskGroup runs while it waits
+enum class EWaitMode : uint8_t {
+    // Any task, from any group
+    AnyTask,
+    // Only the group's own tasks
+    //     - Use while holding locks that other tasks may take, they could otherwise be run on this thread
+    GroupTasks,
+};
+
+// - Tracks a set of submitted tasks so they can be waited on
+// - Must outlive every task submitted with it
+struct TaskGroup {
+    bool IsDone () const;
+
+private:
+    friend class Scheduler;
+    std::atomic<uint32_t> m_pending{ 0 };
+};
+
+namespace impl {
+
+struct Task {
+    void (*function)(void* context) = nullptr;
+    void* context = nullptr;
+    TaskGroup* group = nullptr;
+};
+
+// - Ring buffer of tasks owned by one worker
+// - The owner pushes and pops at the back, other threads steal from the front
+struct TaskDeque {
+    explicit TaskDeque (std::pmr::memory_resource* resource);
+
+    void PushBack (const Task& task);
+    bool PopBack (Task& task);
+    bool PopFront (Task& task);
+    // - Removes the newest task of the group, wherever it is in the deque
+    bool PopGroup (const TaskGroup* group, Task& task);
+
+private:
+    void Grow ();
+
+private:
+    std::mutex m_mutex;
+    std::pmr::vector<Task> m_tasks;
+    size_t m_head = 0;
+    size_t m_count = 0;
+};
+
+} // namespace impl
+
+// - Pool of worker threads with a task deque each
+// - Idle workers steal from the front of other workers' deques
+// - Tasks submitted from a worker go to its own deque, others are spread between workers
+// - Threads waiting on a TaskGroup run queued tasks instead of blocking
+class Scheduler {
+public:
+    Scheduler (const SchedulerSettings& settings = SchedulerSettings(), std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    ~Scheduler ();
+
+    Scheduler (const Scheduler&) = delete;
+    Scheduler& operator= (const Scheduler&) = delete;
+
+public:
+    uint32_t GetThreadCount () const;
+
+    void Submit (TaskGroup& group, void (*function)(void* context), void* context);
+    template<typename T>
+    void Submit (TaskGroup& group, T& function);
+
+    void Wait (TaskGroup& group, EWaitMode mode = EWaitMode::AnyTask);
+
+    // - Keeps a group from being done until the matching Release,
+    //   for work that will only be submitted or finished later
+    void Retain (TaskGroup& group);
+    void Release (TaskGroup& group);
+
+private:
+    void Execute (const impl::Task& task);
+    void PinThread (std::thread& thread, uint32_t core);
+    bool TryPop (uint32_t queueIndex, impl::Task& task);
+    bool TryPopGroup (uint32_t queueIndex, const TaskGroup* group, impl::Task& task);
+    void WorkerMain (uint32_t workerIndex);
+
+private:
+    std::pmr::memory_resource* m_resource;
+    std::vector<impl::TaskDeque*> m_queues;
+    std::vector<std::thread> m_threads;
+
+    std::atomic<uint32_t> m_queuedCount{ 0 };
+    std::atomic<uint32_t> m_nextQueue{ 0 };
+    std::atomic<bool> m_stopping{ false };
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+};
+
+} // namespace ecs
@@ -0,0 +1,51 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "component.h"
+
+#include <cstdint>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+namespace ecs {
+namespace impl {
+
+// - Interns the values of shared components, see ECS_SHARED_COMPONENT
+// - Equal values of a component get the same id, so compositions can tell chunks
+//   apart by id and chunks can hold a single copy of each value
+// - Values are kept for the lifetime of the Manager and never move
+// - Not thread-safe, the Manager only interns values while holding its entity lock exclusively
+struct SharedComponentStore {
+    explicit SharedComponentStore (std::pmr::memory_resource* resource);
+    ~SharedComponentStore ();
+
+    template<typename T>
+    uint32_t Intern (const T& value);
+
+    const void* Get (uint32_t valueId) const;
+
+private:
+    uint32_t Intern (ComponentIndex componentIndex, const void* value, size_t size, size_t alignment);
+
+private:
+    struct Value {
+        ComponentIndex componentIndex;
+        size_t size;
+        size_t alignment;
+        void* data;
+    };
+
+    std::pmr::memory_resource* m_resource;
+    // Indexed by value id
+    std::pmr::vector<Value> m_values;
+    // Hash of the component index and value bytes to value ids
+    std::pmr::unordered_multimap<uint64_t, uint32_t> m_lookup;
+};
+
+} // namespace impl
+} // namespace ecs
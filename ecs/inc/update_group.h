@@ -0,0 +1,51 @@
+// ----------------------------------------------------------------------------
+// Copyright (c) 2020 Riley Diederich
+// License (MIT): https://github.com/RyeToastyO/Ecs/blob/master/LICENSE
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+namespace ecs {
+
+// - Declares a sequence of jobs for Manager->RunUpdateGroup<T>()
+//     - i.e. using PhysicsGroup = ecs::UpdateGroup<IntegrateJob, CollideJob>;
+// - Jobs run in the order listed, a listed UpdateGroup runs all of its jobs in its place
+// - Commands queued by every job are applied together once the last job finishes,
+//   so jobs in a group don't see each other's queued changes
+template<typename...Jobs>
+struct UpdateGroup {};
+
+namespace impl {
+
+template<typename...Groups>
+struct ConcatUpdateGroups;
+
+template<>
+struct ConcatUpdateGroups<> {
+    using type = UpdateGroup<>;
+};
+
+template<typename...Jobs>
+struct ConcatUpdateGroups<UpdateGroup<Jobs...>> {
+    using type = UpdateGroup<Jobs...>;
+};
+
+template<typename...Jobs1, typename...Jobs2, typename...Groups>
+struct ConcatUpdateGroups<UpdateGroup<Jobs1...>, UpdateGroup<Jobs2...>, Groups...> {
+    using type = typename ConcatUpdateGroups<UpdateGroup<Jobs1..., Jobs2...>, Groups...>::type;
+};
+
+// - The jobs of nested update groups, in the order they run
+// - A job on its own is a group of one
+template<typename T>
+struct FlattenUpdateGroup {
+    using type = UpdateGroup<T>;
+};
+
+template<typename...Jobs>
+struct FlattenUpdateGroup<UpdateGroup<Jobs...>> {
+    using type = typename ConcatUpdateGroups<typename FlattenUpdateGroup<Jobs>::type...>::type;
+};
+
+} // namespace impl
+} // namespace ecs
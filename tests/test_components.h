@@ -16,6 +16,8 @@ struct TagC { ECS_COMPONENT(TagC) };
 
 struct EntityReference { ECS_COMPONENT(EntityReference) ecs::Entity Value; };
 
+struct ByteA { ECS_COMPONENT(ByteA) uint8_t Value = 0; };
+
 struct DoubleA { ECS_COMPONENT(DoubleA) double Value = 0.0; };
 struct DoubleB { ECS_COMPONENT(DoubleB) double Value = 0.0; };
 struct DoubleC { ECS_COMPONENT(DoubleC) double Value = 0.0; };
@@ -32,6 +34,15 @@ struct UintA { ECS_COMPONENT(UintA) uint32_t Value = 0; };
 struct UintB { ECS_COMPONENT(UintB) uint32_t Value = 0; };
 struct UintC { ECS_COMPONENT(UintC) uint32_t Value = 0; };
 
+struct SharedA { ECS_SHARED_COMPONENT(SharedA) uint32_t Value = 0; };
+struct SharedB { ECS_SHARED_COMPONENT(SharedB) uint64_t Value = 0; };
+
+struct DynamicMemoryComponent {
+    ECS_COMPONENT(DynamicMemoryComponent)
+
+    std::vector<int> IntVector;
+};
+
 struct SingletonDouble : ecs::ISingletonComponent { ECS_COMPONENT(SingletonDouble) double Value = 0.0; };
 struct SingletonFloat : ecs::ISingletonComponent { ECS_COMPONENT(SingletonFloat) float Value = 0.0f; };
 struct SingletonInt : ecs::ISingletonComponent { ECS_COMPONENT(SingletonInt) int32_t Value = 0; };
@@ -8,12 +8,19 @@
 #include "test_correctness.h"
 #include "test_multi_threading.h"
 
+#include <chrono>
+#include <memory_resource>
+#include <unordered_set>
+
 namespace test {
 
 void TestAssumptions () {
     static_assert(sizeof(ecs::Entity) == (sizeof(uint32_t) + sizeof(uint32_t)), "Unexpected Entity size");
     static_assert(std::is_empty<test::TagA>(), "Unexpected tag size");
     static_assert(sizeof(test::FloatA) == sizeof(float), "Unexpected struct size");
+    static_assert(std::is_trivially_copyable<test::FloatA>(), "Expected to use the trivially copyable storage path");
+    static_assert(std::is_trivially_copyable<ecs::Entity>(), "Expected to use the trivially copyable storage path");
+    static_assert(!std::is_trivially_copyable<test::DynamicMemoryComponent>(), "Expected to use the typed storage path");
 }
 
 void TestEntityComparison () {
@@ -80,6 +87,44 @@ void TestEntityCreationDestruction () {
     }
 }
 
+void TestBulkEntityCreation () {
+    ecs::Manager mgr;
+
+    // Leave some destroyed entities around to be recycled
+    ecs::Entity destroyed[3];
+    for (auto i = 0; i < 3; ++i)
+        destroyed[i] = mgr.CreateEntityImmediate(test::IntA{ -1 });
+    for (auto i = 0; i < 3; ++i)
+        mgr.DestroyImmediate(destroyed[i]);
+
+    const uint32_t count = 5000;
+    std::vector<ecs::Entity> entities(count);
+    mgr.CreateEntitiesImmediate(entities.data(), count, test::IntA{ 7 }, test::FloatA{ 2.0f }, test::TagA{});
+
+    std::unordered_set<ecs::Entity> unique(entities.begin(), entities.end());
+    EXPECT_TRUE(unique.size() == count);
+
+    for (auto i = 0; i < 3; ++i)
+        EXPECT_FALSE(mgr.Exists(destroyed[i]));
+
+    for (const auto& entity : entities) {
+        EXPECT_TRUE(mgr.Exists(entity));
+        EXPECT_TRUE(mgr.HasComponent<test::TagA>(entity));
+        EXPECT_TRUE(mgr.FindComponent<test::IntA>(entity)->Value == 7);
+        EXPECT_TRUE(mgr.FindComponent<test::FloatA>(entity)->Value == 2.0f);
+    }
+
+    // Entities created in bulk behave like any other
+    mgr.DestroyImmediate(entities[0]);
+    mgr.RemoveComponents<test::TagA>(entities[1]);
+    EXPECT_FALSE(mgr.Exists(entities[0]));
+    EXPECT_FALSE(mgr.HasComponent<test::TagA>(entities[1]));
+    EXPECT_TRUE(mgr.FindComponent<test::IntA>(entities[count - 1])->Value == 7);
+
+    // Output is optional
+    mgr.CreateEntitiesImmediate(nullptr, 10, test::IntB{ 1 });
+}
+
 void TestComponentFlags () {
     ecs::impl::ComponentFlags all;
     all.SetFlags<test::FloatA, test::FloatB, test::FloatC>();
@@ -135,6 +180,24 @@ void TestComponentFlags () {
     EXPECT_FALSE(other.HasAll(all));
     EXPECT_TRUE(other.HasAny(all));
     EXPECT_TRUE(other.HasNone(some));
+
+    ecs::impl::ComponentFlags combined = some;
+    combined.SetFlags(other);
+    EXPECT_TRUE(combined == all);
+    EXPECT_TRUE(combined.GetHash() == all.GetHash());
+
+    combined.ClearFlags(some);
+    EXPECT_TRUE(combined == other);
+    EXPECT_FALSE(combined == all);
+    EXPECT_TRUE(none.IsEmpty());
+    EXPECT_FALSE(combined.IsEmpty());
+
+    uint32_t iterated = 0;
+    for (ecs::impl::ComponentIndex index : all) {
+        EXPECT_TRUE(all.Has(index));
+        ++iterated;
+    }
+    EXPECT_TRUE(iterated == 3);
 }
 
 void TestComposition () {
@@ -163,12 +226,21 @@ void TestComposition () {
 
     ecs::impl::Composition compWithFlag;
     compWithFlag.SetComponents(FloatA{ 3.0f }, FloatB{ 6.0f }, TagA{}, TagB{});
-    const ecs::impl::ComponentCollectionFactory& factory = compWithFlag.GetComponentCollectionFactory();
-
-    EXPECT_FALSE(factory.find(ecs::impl::GetComponentId<FloatA>()) == factory.end());
-    EXPECT_FALSE(factory.find(ecs::impl::GetComponentId<FloatB>()) == factory.end());
-    EXPECT_TRUE(factory.find(ecs::impl::GetComponentId<TagA>()) == factory.end());
-    EXPECT_TRUE(factory.find(ecs::impl::GetComponentId<TagB>()) == factory.end());
+    EXPECT_TRUE(compWithFlag.GetComponentFlags().Has<TagA>());
+
+    // Only components with data get storage allocated in chunks
+    using ecs::impl::ComponentRegistry;
+    EXPECT_TRUE(ComponentRegistry::GetInfo(ecs::impl::GetComponentIndex<FloatA>()).allocateCollection != nullptr);
+    EXPECT_TRUE(ComponentRegistry::GetInfo(ecs::impl::GetComponentIndex<FloatB>()).allocateCollection != nullptr);
+    EXPECT_TRUE(ComponentRegistry::GetInfo(ecs::impl::GetComponentIndex<TagA>()).allocateCollection == nullptr);
+    EXPECT_TRUE(ComponentRegistry::GetInfo(ecs::impl::GetComponentIndex<TagB>()).allocateCollection == nullptr);
+    EXPECT_TRUE(ComponentRegistry::GetInfo(ecs::impl::GetComponentIndex<SingletonFloat>()).allocateCollection == nullptr);
+
+    compWithFlag.RemoveComponents<FloatB, TagA>();
+    EXPECT_TRUE(compWithFlag.GetComponentFlags().Has<FloatA>());
+    EXPECT_FALSE(compWithFlag.GetComponentFlags().Has<FloatB>());
+    EXPECT_FALSE(compWithFlag.GetComponentFlags().Has<TagA>());
+    EXPECT_TRUE(compWithFlag.GetComponentFlags().Has<TagB>());
 }
 
 void TestFindingComponents () {
@@ -270,6 +342,104 @@ void TestCompositionChanges () {
     }
 }
 
+void TestCompositionTransitions () {
+    ecs::Manager mgr;
+
+    std::vector<ecs::Entity> entities;
+    for (int i = 0; i < 16; ++i)
+        entities.push_back(mgr.CreateEntityImmediate(test::IntA{ i }, test::FloatA{ (float)i }));
+
+    // Repeat the same transitions so that later iterations use the cached chunks
+    for (int iteration = 0; iteration < 3; ++iteration) {
+        for (int i = 0; i < 16; i += 2)
+            mgr.AddComponents(entities[i], test::TagA{}, test::IntB{ i * 10 });
+
+        for (int i = 0; i < 16; ++i) {
+            EXPECT_TRUE(mgr.HasComponent<test::TagA>(entities[i]) == (i % 2 == 0));
+            EXPECT_TRUE(mgr.FindComponent<test::IntA>(entities[i])->Value == i);
+            EXPECT_TRUE(mgr.FindComponent<test::FloatA>(entities[i])->Value == (float)i);
+            auto intB = mgr.FindComponent<test::IntB>(entities[i]);
+            EXPECT_TRUE(i % 2 == 0 ? intB && intB->Value == i * 10 : !intB);
+        }
+
+        // Adding components that already exist only sets their values
+        mgr.AddComponents(entities[0], test::IntB{ -1 });
+        EXPECT_TRUE(mgr.FindComponent<test::IntB>(entities[0])->Value == -1);
+
+        for (int i = 0; i < 16; i += 2)
+            mgr.RemoveComponents<test::TagA, test::IntB>(entities[i]);
+
+        for (int i = 0; i < 16; ++i) {
+            EXPECT_FALSE(mgr.HasComponent<test::TagA>(entities[i]));
+            EXPECT_FALSE(mgr.HasComponent<test::IntB>(entities[i]));
+            EXPECT_TRUE(mgr.FindComponent<test::IntA>(entities[i])->Value == i);
+        }
+
+        // Removing components that don't exist doesn't move the entity
+        mgr.RemoveComponents<test::TagB>(entities[1]);
+        EXPECT_TRUE(mgr.FindComponent<test::FloatA>(entities[1])->Value == 1.0f);
+    }
+}
+
+void TestFilterOperations () {
+    ecs::Manager mgr;
+
+    ecs::Prefab prefab = mgr.CreatePrefab(test::IntA{ 0 }, test::TagA{});
+
+    std::vector<ecs::Entity> a(100), ab(100), c(100);
+    mgr.CreateEntitiesImmediate(a.data(), 100, test::IntA{ 1 }, test::TagA{});
+    mgr.CreateEntitiesImmediate(ab.data(), 100, test::IntA{ 2 }, test::TagA{}, test::TagB{});
+    mgr.CreateEntitiesImmediate(c.data(), 100, test::IntA{ 3 }, test::TagC{});
+
+    // Add to entities with TagA, some already have FloatA
+    mgr.AddComponents(ab[0], test::FloatA{ 100.0f });
+    mgr.AddComponents(ecs::Filter().Require<test::TagA>(), test::FloatA{ 5.0f });
+
+    for (auto i = 0; i < 100; ++i) {
+        EXPECT_TRUE(mgr.FindComponent<test::FloatA>(a[i])->Value == 5.0f);
+        EXPECT_TRUE(mgr.FindComponent<test::IntA>(a[i])->Value == 1);
+        EXPECT_TRUE(mgr.FindComponent<test::FloatA>(ab[i])->Value == 5.0f);
+        EXPECT_TRUE(mgr.FindComponent<test::IntA>(ab[i])->Value == 2);
+        EXPECT_FALSE(mgr.HasComponent<test::FloatA>(c[i]));
+    }
+
+    // Remove from entities with TagA but not TagB
+    mgr.RemoveComponents<test::FloatA, test::TagA>(ecs::Filter().Require<test::TagA>().Exclude<test::TagB>());
+
+    for (auto i = 0; i < 100; ++i) {
+        EXPECT_FALSE(mgr.HasComponent<test::FloatA>(a[i]));
+        EXPECT_FALSE(mgr.HasComponent<test::TagA>(a[i]));
+        EXPECT_TRUE(mgr.FindComponent<test::IntA>(a[i])->Value == 1);
+        EXPECT_TRUE(mgr.HasComponent<test::FloatA>(ab[i]));
+        EXPECT_TRUE(mgr.HasComponent<test::TagA>(ab[i]));
+    }
+
+    // Destroy entities with either TagB or TagC
+    mgr.DestroyImmediate(ecs::Filter().RequireAny<test::TagB, test::TagC>());
+
+    for (auto i = 0; i < 100; ++i) {
+        EXPECT_TRUE(mgr.Exists(a[i]));
+        EXPECT_FALSE(mgr.Exists(ab[i]));
+        EXPECT_FALSE(mgr.Exists(c[i]));
+    }
+
+    // Destroyed entities get recycled as usual
+    ecs::Entity recycled = mgr.CreateEntityImmediate(test::IntB{ 4 });
+    EXPECT_TRUE(mgr.Exists(recycled));
+    EXPECT_TRUE(mgr.FindComponent<test::IntB>(recycled)->Value == 4);
+
+    // Prefabs never match filters
+    ecs::Entity spawned = mgr.SpawnPrefab(prefab);
+    EXPECT_TRUE(mgr.HasComponent<test::TagA>(spawned));
+    mgr.DestroyImmediate(ecs::Filter().Require<test::IntA>());
+    EXPECT_FALSE(mgr.Exists(spawned));
+    EXPECT_FALSE(mgr.Exists(a[0]));
+
+    spawned = mgr.SpawnPrefab(prefab);
+    EXPECT_TRUE(mgr.Exists(spawned));
+    EXPECT_TRUE(mgr.FindComponent<test::IntA>(spawned)->Value == 0);
+}
+
 void TestDestroyMiddleOfChunk () {
     ecs::Manager mgr;
 
@@ -494,6 +664,321 @@ void TestChunkJob () {
     mgr.RunJob<ChunkJobValidate>();
 }
 
+void TestForEach () {
+    ecs::Manager mgr;
+
+    ecs::Entity a = mgr.CreateEntityImmediate(test::FloatA{ 1.0f }, test::FloatB{ 2.0f });
+    ecs::Entity b = mgr.CreateEntityImmediate(test::FloatA{ 1.0f }, test::FloatB{ 3.0f }, test::TagA{});
+    ecs::Entity c = mgr.CreateEntityImmediate(test::FloatA{ 1.0f });
+    ecs::Entity d = mgr.CreateEntityImmediate(test::FloatB{ 4.0f });
+
+    mgr.ForEach<test::FloatA, const test::FloatB>([](test::FloatA& fa, const test::FloatB& fb) {
+        fa.Value += fb.Value;
+    });
+
+    EXPECT_TRUE(mgr.FindComponent<test::FloatA>(a)->Value == 3.0f);
+    EXPECT_TRUE(mgr.FindComponent<test::FloatA>(b)->Value == 4.0f);
+    EXPECT_TRUE(mgr.FindComponent<test::FloatA>(c)->Value == 1.0f);
+    EXPECT_TRUE(mgr.FindComponent<test::FloatB>(d)->Value == 4.0f);
+
+    mgr.ForEach<test::FloatA>(ecs::Filter().Exclude<test::TagA>(), [](test::FloatA& fa) {
+        fa.Value *= 2.0f;
+    });
+
+    EXPECT_TRUE(mgr.FindComponent<test::FloatA>(a)->Value == 6.0f);
+    EXPECT_TRUE(mgr.FindComponent<test::FloatA>(b)->Value == 4.0f);
+    EXPECT_TRUE(mgr.FindComponent<test::FloatA>(c)->Value == 2.0f);
+
+    // Spans several blocks
+    const uint32_t entityCount = 4 * ECS_CHUNK_BLOCK_SIZE / (sizeof(ecs::Entity) + sizeof(test::DoubleA)) + 1;
+    std::vector<ecs::Entity> entities(entityCount);
+    mgr.CreateEntitiesImmediate(entities.data(), entityCount, test::DoubleA{ 0.0 });
+
+    mgr.ForEach<const ecs::Entity, test::DoubleA>([](const ecs::Entity& entity, test::DoubleA& da) {
+        da.Value = (double)entity.index;
+    });
+
+    uint32_t visited = 0;
+    mgr.ForEach<const test::DoubleA>([&visited](const test::DoubleA&) { ++visited; });
+    EXPECT_TRUE(visited == entityCount);
+    for (ecs::Entity entity : entities)
+        EXPECT_TRUE(mgr.FindComponent<test::DoubleA>(entity)->Value == (double)entity.index);
+}
+
+void TestQueries () {
+    ecs::Manager mgr;
+
+    const ecs::Query& query = mgr.GetQuery(ecs::Filter().Require<test::IntA>().Exclude<test::TagA>());
+    EXPECT_TRUE(&query == &mgr.GetQuery(ecs::Filter().Require<test::IntA>().Exclude<test::TagA>()));
+    EXPECT_TRUE(&query != &mgr.GetQuery(ecs::Filter().Require<test::IntA>()));
+
+    // Chunks created after the query are matched as they are created
+    mgr.CreateEntityImmediate(test::IntA{ 1 });
+    mgr.CreateEntityImmediate(test::IntA{ 2 }, test::FloatA{ 1.0f });
+    mgr.CreateEntityImmediate(test::IntA{ 4 }, test::TagA{});
+    mgr.CreateEntityImmediate(test::FloatA{ 1.0f });
+
+    int total = 0;
+    mgr.ForEach<const test::IntA>(query, [&total](const test::IntA& ia) { total += ia.Value; });
+    EXPECT_TRUE(total == 3);
+
+    // A query that requires nothing is tested against every chunk
+    const ecs::Query& anyQuery = mgr.GetQuery(ecs::Filter().RequireAny<test::IntA, test::FloatA>());
+    uint32_t count = 0;
+    mgr.ForEach<const ecs::Entity>(anyQuery, [&count](const ecs::Entity&) { ++count; });
+    EXPECT_TRUE(count == 4);
+
+    mgr.CreateEntityImmediate(test::FloatA{ 1.0f }, test::FloatB{ 1.0f });
+    count = 0;
+    mgr.ForEach<const ecs::Entity>(anyQuery, [&count](const ecs::Entity&) { ++count; });
+    EXPECT_TRUE(count == 5);
+
+    // Pruned chunks are dropped from queries
+    mgr.DestroyImmediate(ecs::Filter().Require<test::IntA>());
+    mgr.PruneUnusedChunks();
+    total = 0;
+    mgr.ForEach<const test::IntA>(query, [&total](const test::IntA& ia) { total += ia.Value; });
+    EXPECT_TRUE(total == 0);
+
+    mgr.CreateEntityImmediate(test::IntA{ 8 });
+    total = 0;
+    mgr.ForEach<const test::IntA>(query, [&total](const test::IntA& ia) { total += ia.Value; });
+    EXPECT_TRUE(total == 8);
+}
+
+struct ChunkBlockJob : ecs::Job {
+    ECS_READ(ecs::Entity, Ent);
+    ECS_WRITE(test::DoubleA, A);
+
+    ECS_WRITE_SINGLETON(SingletonUint, Count);
+
+    void ForEachChunk () override {
+        EXPECT_TRUE(GetChunkEntityCount() > 0);
+
+        // Every array within a block is contiguous
+        const ecs::Entity* entities = Ent.GetChunkComponentArray();
+        test::DoubleA* aArray = A.GetChunkComponentArray();
+        for (uint32_t i = 0; i < GetChunkEntityCount(); ++i)
+            aArray[i].Value = (double)entities[i].index;
+
+        Count->Value += GetChunkEntityCount();
+        Job::ForEachChunk();
+    }
+
+    void ForEach () override {
+        EXPECT_TRUE(A->Value == (double)Ent->index);
+    }
+};
+
+struct ChangedCountJob : ecs::Job {
+    ECS_READ_CHANGED(test::IntA, A);
+
+    ECS_WRITE_SINGLETON(SingletonUint, Count);
+
+    void ForEach () override {
+        Count->Value += 1;
+    }
+};
+
+struct WriteIntAJob : ecs::Job {
+    ECS_WRITE(test::IntA, A);
+    ECS_EXCLUDE(test::FloatA);
+
+    void ForEach () override {
+        A->Value += 1;
+    }
+};
+
+void TestChangeFilter () {
+    ecs::Manager mgr;
+    SingletonUint* count = mgr.GetSingletonComponent<SingletonUint>();
+
+    ecs::Entity a = mgr.CreateEntityImmediate(test::IntA{ 1 });
+    mgr.CreateEntityImmediate(test::IntA{ 2 });
+    ecs::Entity b = mgr.CreateEntityImmediate(test::IntA{ 3 }, test::FloatA{ 1.0f });
+
+    // Every chunk is new to the first run
+    mgr.RunJob<ChangedCountJob>();
+    EXPECT_TRUE(count->Value == 3);
+
+    // Nothing changed
+    count->Value = 0;
+    mgr.RunJob<ChangedCountJob>();
+    EXPECT_TRUE(count->Value == 0);
+
+    // Only the written chunk is visited
+    mgr.RunJob<WriteIntAJob>();
+    mgr.RunJob<ChangedCountJob>();
+    EXPECT_TRUE(count->Value == 2);
+
+    count->Value = 0;
+    mgr.AddComponents(b, test::IntA{ 4 });
+    mgr.RunJob<ChangedCountJob>();
+    EXPECT_TRUE(count->Value == 1);
+
+    // Writes to other components don't count
+    count->Value = 0;
+    mgr.AddComponents(b, test::FloatA{ 2.0f });
+    mgr.RunJob<ChangedCountJob>();
+    EXPECT_TRUE(count->Value == 0);
+
+    // Structural changes do
+    mgr.DestroyImmediate(a);
+    mgr.RunJob<ChangedCountJob>();
+    EXPECT_TRUE(count->Value == 1);
+
+    count->Value = 0;
+    mgr.ForEach<test::IntA>([](test::IntA& ia) { ia.Value += 1; });
+    mgr.RunJob<ChangedCountJob>();
+    EXPECT_TRUE(count->Value == 2);
+}
+
+struct SharedChunkJob : ecs::Job {
+    ECS_READ_SHARED(test::SharedA, Shared);
+    ECS_READ(test::IntA, A);
+
+    ECS_WRITE_SINGLETON(SingletonUint, Total);
+
+    void ForEachChunk () override {
+        // Every entity in the chunk has the same value
+        Total->Value += Shared->Value * GetChunkEntityCount();
+        Job::ForEachChunk();
+    }
+
+    void ForEach () override {
+        EXPECT_TRUE((uint32_t)A->Value == Shared->Value);
+    }
+};
+
+void TestSharedComponents () {
+    ecs::Manager mgr;
+
+    ecs::Entity a = mgr.CreateEntityImmediate(test::IntA{ 1 }, test::SharedA{ 1 });
+    ecs::Entity b = mgr.CreateEntityImmediate(test::IntA{ 1 }, test::SharedA{ 1 });
+    ecs::Entity c = mgr.CreateEntityImmediate(test::IntA{ 2 }, test::SharedA{ 2 });
+    ecs::Entity d = mgr.CreateEntityImmediate(test::IntA{ 3 });
+
+    // Equal values share a chunk, and the value is stored once
+    EXPECT_TRUE(mgr.FindSharedComponent<test::SharedA>(a) == mgr.FindSharedComponent<test::SharedA>(b));
+    EXPECT_TRUE(mgr.FindSharedComponent<test::SharedA>(a) != mgr.FindSharedComponent<test::SharedA>(c));
+    EXPECT_TRUE(mgr.FindSharedComponent<test::SharedA>(c)->Value == 2);
+    EXPECT_TRUE(mgr.FindSharedComponent<test::SharedA>(d) == nullptr);
+    EXPECT_TRUE(mgr.HasComponent<test::SharedA>(a));
+    EXPECT_TRUE(!mgr.HasComponent<test::SharedA>(d));
+
+    mgr.RunJob<SharedChunkJob>();
+    EXPECT_TRUE(mgr.GetSingletonComponent<SingletonUint>()->Value == 4);
+
+    // Changing the value moves the entity, adding other components keeps it
+    mgr.AddComponents(b, test::IntA{ 2 }, test::SharedA{ 2 });
+    mgr.AddComponents(d, test::SharedA{ 3 });
+    mgr.AddComponents(a, test::FloatA{ 1.0f });
+    EXPECT_TRUE(mgr.FindSharedComponent<test::SharedA>(b) == mgr.FindSharedComponent<test::SharedA>(c));
+    EXPECT_TRUE(mgr.FindSharedComponent<test::SharedA>(a)->Value == 1);
+    EXPECT_TRUE(mgr.FindSharedComponent<test::SharedA>(d)->Value == 3);
+
+    mgr.GetSingletonComponent<SingletonUint>()->Value = 0;
+    mgr.RunJob<SharedChunkJob>();
+    EXPECT_TRUE(mgr.GetSingletonComponent<SingletonUint>()->Value == 8);
+
+    // Several shared components, spawned and batch created
+    ecs::Prefab prefab = mgr.CreatePrefab(test::IntA{ 4 }, test::SharedA{ 4 }, test::SharedB{ 5 });
+    ecs::Entity e = mgr.SpawnPrefab(prefab);
+    EXPECT_TRUE(mgr.FindSharedComponent<test::SharedA>(e)->Value == 4);
+    EXPECT_TRUE(mgr.FindSharedComponent<test::SharedB>(e)->Value == 5);
+
+    ecs::Entity batch[3];
+    mgr.CreateEntitiesImmediate(batch, 3, test::IntA{ 4 }, test::SharedB{ 5 }, test::SharedA{ 4 });
+    EXPECT_TRUE(mgr.FindSharedComponent<test::SharedA>(batch[2]) == mgr.FindSharedComponent<test::SharedA>(e));
+
+    mgr.RemoveComponents<test::SharedB>(e);
+    EXPECT_TRUE(mgr.FindSharedComponent<test::SharedB>(e) == nullptr);
+    EXPECT_TRUE(mgr.FindSharedComponent<test::SharedA>(e)->Value == 4);
+
+    // Filters match on the component, whatever its value
+    mgr.DestroyImmediate(ecs::Filter().Require<test::SharedB>());
+    EXPECT_TRUE(mgr.Exists(e) && !mgr.Exists(batch[0]));
+
+    mgr.GetSingletonComponent<SingletonUint>()->Value = 0;
+    mgr.RunJob<SharedChunkJob>();
+    EXPECT_TRUE(mgr.GetSingletonComponent<SingletonUint>()->Value == 12);
+}
+
+void TestChunkBlocks () {
+    ecs::Manager mgr;
+
+    // Enough entities to need several blocks
+    const uint32_t entityCount = 4 * ECS_CHUNK_BLOCK_SIZE / (sizeof(ecs::Entity) + sizeof(test::DoubleA)) + 1;
+
+    std::vector<ecs::Entity> entities;
+    for (uint32_t i = 0; i < entityCount; ++i)
+        entities.push_back(mgr.CreateEntityImmediate(test::DoubleA{ (double)i }, test::DynamicMemoryComponent{ { (int)i } }));
+
+    mgr.RunJob<ChunkBlockJob>();
+    EXPECT_TRUE(mgr.GetSingletonComponent<SingletonUint>()->Value == entityCount);
+
+    // Destroying from the front pulls the tail of the last block into the first
+    for (uint32_t i = 0; i < entityCount / 2; ++i)
+        mgr.DestroyImmediate(entities[i]);
+
+    for (uint32_t i = entityCount / 2; i < entityCount; ++i) {
+        EXPECT_TRUE(mgr.FindComponent<test::DoubleA>(entities[i])->Value == (double)entities[i].index);
+        EXPECT_TRUE(mgr.FindComponent<test::DynamicMemoryComponent>(entities[i])->IntVector[0] == (int)i);
+    }
+
+    mgr.GetSingletonComponent<SingletonUint>()->Value = 0;
+    mgr.RunJob<ChunkBlockJob>();
+    EXPECT_TRUE(mgr.GetSingletonComponent<SingletonUint>()->Value == entityCount - entityCount / 2);
+}
+
+struct PaddedChunkJob : ecs::Job {
+    ECS_READ(test::ByteA, Byte);
+    ECS_WRITE(test::FloatA, A);
+    ECS_READ(test::DoubleA, B);
+
+    ECS_WRITE_SINGLETON(SingletonUint, Count);
+
+    void ForEachChunk () override {
+        const uint32_t count = GetChunkEntityCount();
+        const uint32_t paddedCount = GetChunkPaddedEntityCount();
+        EXPECT_TRUE(paddedCount >= count);
+        EXPECT_TRUE(paddedCount % ECS_CHUNK_LANE_COUNT == 0);
+        EXPECT_TRUE(paddedCount - count < ECS_CHUNK_LANE_COUNT);
+
+        EXPECT_TRUE((uintptr_t)Byte.GetChunkComponentArray() % ECS_CHUNK_ARRAY_ALIGNMENT == 0);
+        EXPECT_TRUE((uintptr_t)A.GetChunkComponentArray() % ECS_CHUNK_ARRAY_ALIGNMENT == 0);
+        EXPECT_TRUE((uintptr_t)B.GetChunkComponentArray() % ECS_CHUNK_ARRAY_ALIGNMENT == 0);
+
+        // No scalar tail, the padding is scratch space
+        test::FloatA* aArray = A.GetChunkComponentArray();
+        const test::DoubleA* bArray = B.GetChunkComponentArray();
+        for (uint32_t i = 0; i < paddedCount; ++i)
+            aArray[i].Value += (float)bArray[i].Value;
+
+        Count->Value += count;
+    }
+};
+
+void TestPaddedChunkArrays () {
+    ecs::Manager mgr;
+
+    // Several full blocks plus a partial one
+    const uint32_t entityCount = 3 * ECS_CHUNK_BLOCK_SIZE / (sizeof(ecs::Entity) + sizeof(test::ByteA) + sizeof(test::FloatA) + sizeof(test::DoubleA)) + 5;
+
+    std::vector<ecs::Entity> entities(entityCount);
+    mgr.CreateEntitiesImmediate(entities.data(), entityCount, test::ByteA{ 1 }, test::FloatA{ 1.0f }, test::DoubleA{ 2.0 });
+
+    mgr.RunJob<PaddedChunkJob>();
+    EXPECT_TRUE(mgr.GetSingletonComponent<SingletonUint>()->Value == entityCount);
+
+    for (auto entity : entities)
+        EXPECT_TRUE(mgr.FindComponent<test::FloatA>(entity)->Value == 3.0f);
+
+    // Scratch writes aren't kept, an entity created into a padded slot has the values it was given
+    ecs::Entity created = mgr.CreateEntityImmediate(test::ByteA{ 1 }, test::FloatA{ 5.0f }, test::DoubleA{ 1.0 });
+    EXPECT_TRUE(mgr.FindComponent<test::FloatA>(created)->Value == 5.0f);
+}
+
 struct QueuedChangeJob : ecs::Job {
     ECS_READ(ecs::Entity, Ent);
     ECS_READ(test::EntityReference, Ref);
@@ -535,6 +1020,363 @@ void TestQueuedChanges () {
     EXPECT_TRUE(mgr.GetSingletonComponent<test::SingletonFloat>()->Value == 6.0f);
 }
 
+struct CoalescedChangeJob : ecs::Job {
+    ECS_READ(ecs::Entity, Ent);
+    ECS_READ(test::IntA, A);
+
+    void ForEach () override {
+        switch (A->Value) {
+            case 0:
+                // Later values win, removed components are never added
+                QueueAddComponents(*Ent, test::IntB{ 1 }, test::FloatA{ 1.0f });
+                QueueAddComponents(*Ent, test::IntB{ 2 }, test::TagA{});
+                QueueRemoveComponents<test::FloatA>(*Ent);
+                break;
+            case 1:
+                // Removed and added again
+                QueueRemoveComponents<test::IntA>(*Ent);
+                QueueAddComponents(*Ent, test::IntA{ 10 }, test::SharedA{ 3 });
+                QueueAddComponents(*Ent, test::SharedA{ 4 });
+                break;
+            case 2:
+                // Changes to a destroyed entity are dropped
+                QueueAddComponents(*Ent, test::IntB{ 5 });
+                QueueDestroyEntity(*Ent);
+                break;
+            case 3:
+                // Clones see the changes queued before them
+                QueueAddComponents(*Ent, test::IntB{ 6 });
+                QueueCloneEntity(*Ent);
+                QueueAddComponents(test::FloatA{ 7.0f });
+                QueueRemoveComponents<test::IntA>();
+                break;
+        }
+        QueueCreateEntity(test::UintA{ (uint32_t)A->Value }, test::FloatB{ 1.0f }, test::TagB{});
+        QueueAddComponents(test::UintA{ (uint32_t)A->Value + 100 }, test::DoubleA{ 2.0 });
+        QueueRemoveComponents<test::FloatB>();
+    }
+};
+
+void TestCoalescedQueuedChanges () {
+    ecs::Manager mgr;
+
+    ecs::Entity entities[4];
+    for (int32_t i = 0; i < 4; ++i)
+        entities[i] = mgr.CreateEntityImmediate(test::IntA{ i });
+
+    mgr.RunJob<CoalescedChangeJob>();
+
+    EXPECT_TRUE(mgr.FindComponent<test::IntB>(entities[0])->Value == 2);
+    EXPECT_TRUE(mgr.HasComponent<test::TagA>(entities[0]));
+    EXPECT_FALSE(mgr.HasComponent<test::FloatA>(entities[0]));
+
+    EXPECT_TRUE(mgr.FindComponent<test::IntA>(entities[1])->Value == 10);
+    EXPECT_TRUE(mgr.FindSharedComponent<test::SharedA>(entities[1])->Value == 4);
+
+    EXPECT_FALSE(mgr.Exists(entities[2]));
+
+    EXPECT_TRUE(mgr.FindComponent<test::IntB>(entities[3])->Value == 6);
+    EXPECT_FALSE(mgr.HasComponent<test::FloatA>(entities[3]));
+
+    uint32_t clones = 0;
+    mgr.ForEach<const test::IntB, const test::FloatA>(ecs::Filter().Exclude<test::IntA>(), [&clones](const test::IntB& ib, const test::FloatA& fa) {
+        EXPECT_TRUE(ib.Value == 6 && fa.Value == 7.0f);
+        ++clones;
+    });
+    EXPECT_TRUE(clones == 1);
+
+    // Created entities go straight to their final composition
+    uint32_t created = 0;
+    uint32_t total = 0;
+    mgr.ForEach<const test::UintA, const test::DoubleA>(ecs::Filter().Require<test::TagB>().Exclude<test::FloatB>(), [&](const test::UintA& ua, const test::DoubleA& da) {
+        EXPECT_TRUE(da.Value == 2.0);
+        total += ua.Value;
+        ++created;
+    });
+    EXPECT_TRUE(created == 4);
+    EXPECT_TRUE(total == 100 + 101 + 102 + 103);
+
+    // Entities moving between the same chunks move together, the ones left behind stay valid
+    std::vector<ecs::Entity> batch;
+    for (int32_t i = 0; i < 1000; ++i)
+        batch.push_back(mgr.CreateEntityImmediate(test::IntA{ i % 2 == 0 ? 0 : 5 }));
+    mgr.RunJob<CoalescedChangeJob>();
+    for (int32_t i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(mgr.FindComponent<test::IntA>(batch[i])->Value == (i % 2 == 0 ? 0 : 5));
+        EXPECT_TRUE(mgr.HasComponent<test::IntB>(batch[i]) == (i % 2 == 0));
+    }
+}
+
+struct ReservedPrefab : ecs::ISingletonComponent { ECS_COMPONENT(ReservedPrefab) ecs::Prefab Value; };
+
+struct ReservedEntityJob : ecs::Job {
+    ECS_READ(ecs::Entity, Ent);
+    ECS_READ(test::IntA, A);
+    ECS_EXCLUDE(test::EntityReference);
+
+    ECS_READ_SINGLETON(ReservedPrefab, Prefab);
+
+    void ForEach () override {
+        // Created entities can be referenced and acted on before they exist
+        ecs::Entity created = QueueCreateEntity(test::IntB{ A->Value });
+        EXPECT_FALSE(HasComponent<test::IntB>(created));
+        QueueAddComponents(created, test::EntityReference{ *Ent });
+        QueueAddComponents(*Ent, test::EntityReference{ created });
+
+        ecs::Entity spawned = QueueSpawnPrefab(Prefab->Value);
+        QueueAddComponents(spawned, test::IntB{ A->Value + 100 });
+
+        ecs::Entity clone = QueueCloneEntity(*Ent);
+        QueueRemoveComponents<test::IntA>(clone);
+        QueueAddComponents(clone, test::IntB{ A->Value + 200 });
+
+        // Destroyed before it was ever created
+        ecs::Entity discarded = QueueCreateEntity(test::IntB{ -1 });
+        QueueDestroyEntity(discarded);
+    }
+};
+
+void TestQueuedEntityReservation () {
+    ecs::Manager mgr;
+
+    ecs::Entity entities[4];
+    for (int32_t i = 0; i < 4; ++i)
+        entities[i] = mgr.CreateEntityImmediate(test::IntA{ i });
+
+    // Recycled entities are reserved too
+    mgr.DestroyImmediate(mgr.CreateEntityImmediate(test::IntA{ 100 }));
+    mgr.DestroyImmediate(mgr.CreateEntityImmediate(test::IntA{ 100 }));
+
+    mgr.GetSingletonComponent<ReservedPrefab>()->Value = mgr.CreatePrefab(test::FloatA{ 1.0f });
+
+    mgr.RunJob<ReservedEntityJob>();
+
+    for (int32_t i = 0; i < 4; ++i) {
+        ecs::Entity created = mgr.FindComponent<test::EntityReference>(entities[i])->Value;
+        EXPECT_TRUE(mgr.Exists(created));
+        EXPECT_TRUE(mgr.FindComponent<test::IntB>(created)->Value == i);
+        EXPECT_TRUE(mgr.FindComponent<test::EntityReference>(created)->Value == entities[i]);
+    }
+
+    std::vector<ecs::Entity> spawned;
+    mgr.ForEach<const ecs::Entity, const test::IntB>(ecs::Filter().Require<test::FloatA>(), [&spawned](const ecs::Entity& entity, const test::IntB& ib) {
+        EXPECT_TRUE(ib.Value >= 100 && ib.Value < 104);
+        spawned.push_back(entity);
+    });
+    EXPECT_TRUE(spawned.size() == 4);
+    for (ecs::Entity entity : spawned)
+        EXPECT_FALSE(mgr.HasComponent<ecs::impl::PrefabComponent>(entity));
+
+    uint32_t clones = 0;
+    mgr.ForEach<const test::IntB, const test::EntityReference>(ecs::Filter().Exclude<test::IntA>(), [&](const test::IntB& ib, const test::EntityReference&) {
+        if (ib.Value >= 200)
+            ++clones;
+    });
+    EXPECT_TRUE(clones == 4);
+
+    uint32_t discarded = 0;
+    mgr.ForEach<const test::IntB>([&discarded](const test::IntB& ib) { discarded += ib.Value == -1; });
+    EXPECT_TRUE(discarded == 0);
+
+    // Released reservations are recycled with a new generation
+    ecs::Entity recycled = mgr.CreateEntityImmediate(test::IntA{ 5 });
+    EXPECT_TRUE(mgr.Exists(recycled));
+    EXPECT_TRUE(mgr.FindComponent<test::IntA>(recycled)->Value == 5);
+}
+
+using QueuedChangeGroup = ecs::UpdateGroup<QueuedChangeJob, QueuedChangeTotal>;
+using NestedTotalGroup = ecs::UpdateGroup<ecs::UpdateGroup<QueuedChangeTotal>, QueuedChangeTotal>;
+
+void TestUpdateGroups () {
+    ecs::Manager mgr;
+
+    ecs::Entity a = mgr.CreateEntityImmediate(test::FloatA{ 10.0f });
+    ecs::Entity b = mgr.CreateEntityImmediate(test::FloatA{ 20.0f });
+    ecs::Entity c = mgr.CreateEntityImmediate(test::TagA{}, test::EntityReference{ a });
+    ecs::Entity d = mgr.CreateEntityImmediate(test::TagA{}, test::EntityReference{ b });
+
+    // Queued changes wait for the end of the group
+    mgr.RunUpdateGroup<QueuedChangeGroup>();
+    EXPECT_TRUE(mgr.GetSingletonComponent<test::SingletonFloat>()->Value == 30.0f);
+
+    EXPECT_FALSE(mgr.Exists(a));
+    EXPECT_FALSE(mgr.Exists(b));
+    EXPECT_TRUE(mgr.FindComponent<test::FloatA>(c)->Value == 1.0f);
+    EXPECT_TRUE(mgr.FindComponent<test::FloatA>(d)->Value == 1.0f);
+
+    // Nested groups run their jobs in place
+    mgr.GetSingletonComponent<test::SingletonFloat>()->Value = 0.0f;
+    mgr.RunUpdateGroup<NestedTotalGroup>();
+    EXPECT_TRUE(mgr.GetSingletonComponent<test::SingletonFloat>()->Value == 12.0f);
+}
+
+// - Tracks bytes handed out so tests can verify where a Manager allocates from
+struct CountingMemoryResource : std::pmr::memory_resource {
+    CountingMemoryResource (std::pmr::memory_resource* upstream) : m_upstream(upstream) {}
+
+    size_t m_allocated = 0;
+    size_t m_outstanding = 0;
+
+private:
+    void* do_allocate (size_t bytes, size_t alignment) override {
+        m_allocated += bytes;
+        m_outstanding += bytes;
+        return m_upstream->allocate(bytes, alignment);
+    }
+
+    void do_deallocate (void* ptr, size_t bytes, size_t alignment) override {
+        m_outstanding -= bytes;
+        m_upstream->deallocate(ptr, bytes, alignment);
+    }
+
+    bool do_is_equal (const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* m_upstream;
+};
+
+void TestMemoryResource () {
+    // Arena that can't grow, running out throws instead of falling back to the heap
+    std::vector<uint8_t> buffer(4 * 1024 * 1024);
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+    CountingMemoryResource counterA(&arena);
+    CountingMemoryResource counterB(std::pmr::get_default_resource());
+
+    {
+        ecs::Manager mgrA(&counterA);
+        ecs::Manager mgrB(&counterB);
+        EXPECT_TRUE(mgrA.GetMemoryResource() == &counterA);
+
+        std::vector<ecs::Entity> entities(1000);
+        mgrA.CreateEntitiesImmediate(entities.data(), 1000, test::FloatA{ 1.0f }, test::DynamicMemoryComponent{});
+        for (auto i = 0; i < 100; ++i)
+            mgrA.CreateEntityImmediate(test::TagA{}, test::EntityReference{ entities[i] });
+
+        EXPECT_TRUE(counterA.m_allocated > 0);
+        EXPECT_TRUE(counterB.m_allocated == 0);
+
+        mgrA.RunJob<QueuedChangeJob>();
+        for (auto i = 0; i < 100; ++i)
+            EXPECT_FALSE(mgrA.Exists(entities[i]));
+
+        mgrA.DestroyImmediate(ecs::Filter().Require<test::FloatA>());
+        EXPECT_TRUE(counterB.m_allocated == 0);
+
+        // The scheduler's task queues too
+        const size_t allocated = counterA.m_allocated;
+        mgrA.GetScheduler();
+        EXPECT_TRUE(counterA.m_allocated > allocated);
+        EXPECT_TRUE(counterB.m_allocated == 0);
+
+        mgrB.CreateEntityImmediate(test::FloatA{ 1.0f });
+        EXPECT_TRUE(counterB.m_allocated > 0);
+    }
+
+    EXPECT_TRUE(counterA.m_outstanding == 0);
+    EXPECT_TRUE(counterB.m_outstanding == 0);
+}
+
+struct LargeComponent { ECS_COMPONENT(LargeComponent) int32_t Values[ECS_COMMAND_BLOCK_SIZE / sizeof(int32_t)]; };
+struct alignas(64) AlignedComponent { ECS_COMPONENT(AlignedComponent) double Value = 0.0; };
+
+struct CommandBufferJob : ecs::Job {
+    ECS_READ(ecs::Entity, Ent);
+    ECS_READ(test::IntA, A);
+
+    void ForEach () override {
+        QueueAddComponents(*Ent, test::DynamicMemoryComponent{ std::vector<int>(3, A->Value) }, AlignedComponent{ (double)A->Value });
+        if (A->Value % 100 == 0) {
+            LargeComponent large;
+            large.Values[0] = A->Value;
+            large.Values[ECS_COMMAND_BLOCK_SIZE / sizeof(int32_t) - 1] = -A->Value;
+            QueueAddComponents(*Ent, large);
+        }
+    }
+};
+
+void TestCommandBuffer () {
+    CountingMemoryResource counter(std::pmr::get_default_resource());
+    {
+        ecs::Manager mgr(&counter);
+
+        std::vector<ecs::Entity> entities;
+        for (int32_t i = 0; i < 1000; ++i)
+            entities.push_back(mgr.CreateEntityImmediate(test::IntA{ i }));
+
+        // Commands span many blocks, some larger than a block, and are written over on the second run
+        for (int32_t run = 0; run < 2; ++run) {
+            mgr.RunJob<CommandBufferJob>();
+            for (int32_t i = 0; i < 1000; ++i) {
+                const auto* dynamic = mgr.FindComponent<test::DynamicMemoryComponent>(entities[i]);
+                EXPECT_TRUE(dynamic->IntVector.size() == 3 && dynamic->IntVector[2] == i);
+
+                const AlignedComponent* aligned = mgr.FindComponent<AlignedComponent>(entities[i]);
+                EXPECT_TRUE(aligned->Value == (double)i);
+
+                const LargeComponent* large = mgr.FindComponent<LargeComponent>(entities[i]);
+                EXPECT_TRUE((large != nullptr) == (i % 100 == 0));
+                if (large)
+                    EXPECT_TRUE(large->Values[0] == i && large->Values[ECS_COMMAND_BLOCK_SIZE / sizeof(int32_t) - 1] == -i);
+            }
+        }
+    }
+    EXPECT_TRUE(counter.m_outstanding == 0);
+}
+
+struct PruneCountJob : ecs::Job {
+    ECS_READ(test::IntA, A);
+
+    ECS_WRITE_SINGLETON(SingletonUint, Total);
+
+    void ForEach () override {
+        Total->Value += (uint32_t)A->Value;
+    }
+};
+
+void TestPruneUnusedChunks () {
+    CountingMemoryResource counter(std::pmr::get_default_resource());
+    ecs::Manager mgr(&counter);
+
+    ecs::Entity entity = mgr.CreateEntityImmediate(test::IntA{ 1 });
+    mgr.RunJob<PruneCountJob>();
+
+    // Pass through some short-lived compositions
+    mgr.AddComponents(entity, test::TagA{});
+    mgr.AddComponents(entity, test::TagB{});
+    mgr.RemoveComponents<test::TagA, test::TagB>(entity);
+    const size_t outstanding = counter.m_outstanding;
+
+    // Hasn't been empty long enough
+    mgr.PruneUnusedChunks(std::chrono::hours(1));
+    EXPECT_TRUE(counter.m_outstanding == outstanding);
+
+    mgr.PruneUnusedChunks();
+    EXPECT_TRUE(counter.m_outstanding < outstanding);
+    EXPECT_TRUE(mgr.FindComponent<test::IntA>(entity)->Value == 1);
+
+    // Recreating a pruned composition reuses its block
+    const size_t allocated = counter.m_allocated;
+    mgr.AddComponents(entity, test::TagA{});
+    EXPECT_TRUE(counter.m_allocated - allocated < ECS_CHUNK_BLOCK_SIZE);
+    EXPECT_TRUE(mgr.HasComponent<test::TagA>(entity));
+    EXPECT_TRUE(mgr.FindComponent<test::IntA>(entity)->Value == 1);
+
+    mgr.GetSingletonComponent<SingletonUint>()->Value = 0;
+    mgr.RunJob<PruneCountJob>();
+    EXPECT_TRUE(mgr.GetSingletonComponent<SingletonUint>()->Value == 1);
+
+    mgr.DestroyImmediate(entity);
+    mgr.PruneUnusedChunks();
+    mgr.RunJob<PruneCountJob>();
+    EXPECT_TRUE(mgr.GetSingletonComponent<SingletonUint>()->Value == 1);
+
+    ecs::Entity created = mgr.CreateEntityImmediate(test::IntA{ 2 });
+    mgr.RunJob<PruneCountJob>();
+    EXPECT_TRUE(mgr.GetSingletonComponent<SingletonUint>()->Value == 3);
+    EXPECT_TRUE(mgr.Exists(created));
+}
+
 struct CloneJob : ecs::Job {
     ECS_READ(ecs::Entity, Ent);
     ECS_REQUIRE(FloatA, FloatB, FloatC);
@@ -642,12 +1484,111 @@ void TestPrefabs () {
     EXPECT_TRUE(mgr.GetSingletonComponent<SingletonUint>()->Value == 4);
 }
 
-struct DynamicMemoryComponent {
-    ECS_COMPONENT(DynamicMemoryComponent)
+struct PrefabBurstJob : ecs::Job {
+    ECS_READ(IntA, A);
 
-    std::vector<int> IntVector;
+    ECS_READ_SINGLETON(PrefabToSpawn, Prefab);
+
+    void ForEach () override {
+        ecs::Entity spawned[3];
+        QueueSpawnPrefab(Prefab->Value, 3, spawned);
+        QueueAddComponents(spawned[1], IntB{ A->Value });
+        QueueDestroyEntity(spawned[2]);
+    }
 };
 
+void TestBulkPrefabSpawning () {
+    ecs::Manager mgr;
+
+    // Spans several chunk blocks, with components that are and aren't trivially copyable
+    std::vector<int> values = { 1, 2, 3 };
+    ecs::Prefab prefab = mgr.CreatePrefab(FloatA{ 1.0f }, DoubleA{ 2.0 }, SharedA{ 3 }, DynamicMemoryComponent{ values });
+    std::vector<ecs::Entity> spawned(5000);
+    mgr.SpawnPrefab(prefab, (uint32_t)spawned.size(), spawned.data());
+
+    for (ecs::Entity entity : spawned) {
+        EXPECT_TRUE(mgr.Exists(entity));
+        EXPECT_FALSE(mgr.HasComponent<ecs::impl::PrefabComponent>(entity));
+        EXPECT_TRUE(mgr.FindComponent<FloatA>(entity)->Value == 1.0f);
+        EXPECT_TRUE(mgr.FindComponent<DoubleA>(entity)->Value == 2.0);
+        EXPECT_TRUE(mgr.FindSharedComponent<SharedA>(entity)->Value == 3);
+        EXPECT_TRUE(mgr.FindComponent<DynamicMemoryComponent>(entity)->IntVector == values);
+    }
+    // The entity components hold the new handles, not the prefab's
+    std::vector<ecs::Entity> handles;
+    mgr.ForEach<const ecs::Entity>(ecs::Filter().Require<DoubleA>(), [&handles](const ecs::Entity& entity) {
+        handles.push_back(entity);
+    });
+    EXPECT_TRUE(handles == spawned);
+    EXPECT_TRUE(mgr.FindComponent<FloatA>(mgr.SpawnPrefab(prefab))->Value == 1.0f);
+
+    // Invalid prefabs spawn invalid entities
+    ecs::Entity invalid[2];
+    mgr.SpawnPrefab(ecs::Prefab(), 2, invalid);
+    EXPECT_FALSE(mgr.Exists(invalid[0]) || mgr.Exists(invalid[1]));
+
+    // Queued bursts are spawned together and can be acted on before they exist
+    for (int32_t i = 0; i < 10; ++i)
+        mgr.CreateEntityImmediate(IntA{ i });
+    mgr.GetSingletonComponent<PrefabToSpawn>()->Value = prefab;
+    mgr.RunJob<PrefabBurstJob>();
+
+    uint32_t count = 0;
+    int32_t total = 0;
+    mgr.ForEach<const FloatA, const DynamicMemoryComponent>(ecs::Filter().Require<SharedA>(), [&](const FloatA& fa, const DynamicMemoryComponent& dmc) {
+        EXPECT_TRUE(fa.Value == 1.0f && dmc.IntVector == values);
+        ++count;
+    });
+    mgr.ForEach<const IntB>(ecs::Filter().Require<FloatA>(), [&total](const IntB& ib) { total += ib.Value; });
+    EXPECT_TRUE(count == 5001 + 10 * 2);
+    EXPECT_TRUE(total == 45);
+}
+
+void TestMixedComponentStorage () {
+    ecs::Manager mgr;
+
+    // Trivially copyable components are moved as bytes, the rest by their type
+    std::vector<ecs::Entity> entities;
+    for (int i = 0; i < 100; ++i)
+        entities.push_back(mgr.CreateEntityImmediate(test::IntA{ i }, test::DoubleA{ (double)i }, test::DynamicMemoryComponent{ { i } }));
+
+    for (int i = 0; i < 100; i += 2)
+        mgr.AddComponents(entities[i], test::FloatA{ (float)i });
+    for (int i = 0; i < 100; i += 3)
+        mgr.DestroyImmediate(entities[i]);
+    for (int i = 0; i < 100; i += 4)
+        mgr.RemoveComponents<test::DoubleA>(entities[i]);
+
+    ecs::Entity clone = mgr.Clone(entities[1]);
+    mgr.RemoveComponents<test::IntA>(ecs::Filter().Require<test::FloatA>());
+
+    for (int i = 0; i < 100; ++i) {
+        ecs::Entity entity = entities[i];
+        EXPECT_TRUE(mgr.Exists(entity) == (i % 3 != 0));
+        if (!mgr.Exists(entity))
+            continue;
+
+        EXPECT_TRUE(mgr.FindComponent<test::DynamicMemoryComponent>(entity)->IntVector[0] == i);
+        if (i % 2 == 0) {
+            EXPECT_TRUE(mgr.FindComponent<test::FloatA>(entity)->Value == (float)i);
+            EXPECT_FALSE(mgr.HasComponent<test::IntA>(entity));
+        }
+        else {
+            EXPECT_TRUE(mgr.FindComponent<test::IntA>(entity)->Value == i);
+        }
+        if (i % 4 == 0) {
+            EXPECT_FALSE(mgr.HasComponent<test::DoubleA>(entity));
+        }
+        else {
+            EXPECT_TRUE(mgr.FindComponent<test::DoubleA>(entity)->Value == (double)i);
+        }
+    }
+
+    EXPECT_TRUE(mgr.FindComponent<test::IntA>(clone)->Value == 1);
+    EXPECT_TRUE(mgr.FindComponent<test::DoubleA>(clone)->Value == 1.0);
+    EXPECT_TRUE(mgr.FindComponent<test::DynamicMemoryComponent>(clone)->IntVector[0] == 1);
+}
+
 void TestDynamicMemoryComponent () {
     ecs::Manager ecs;
 
@@ -700,20 +1641,44 @@ void TestCorrectness () {
     TestAssumptions();
     TestEntityComparison();
     TestEntityCreationDestruction();
+    TestBulkEntityCreation();
     TestComponentFlags();
     TestComposition();
     TestFindingComponents();
     TestCompositionChanges();
+    TestCompositionTransitions();
+    TestFilterOperations();
     TestDestroyMiddleOfChunk();
     TestJob();
     TestReadWriteOther();
     TestSingletonComponents();
     TestChunkJob();
+    TestForEach();
+    TestQueries();
+    TestChangeFilter();
+    TestSharedComponents();
+    TestChunkBlocks();
+    TestPaddedChunkArrays();
     TestManualMultiThreading();
+    TestParallelJob();
+    TestParallelJobCommandOrder();
+    TestParallelJobReservationGrowth();
+    TestScheduler();
+    TestRunJobsMultithreaded();
+    TestRunJobAsync();
+    TestParallelJobWaitWithAsyncJobs();
     TestQueuedChanges();
+    TestCoalescedQueuedChanges();
+    TestQueuedEntityReservation();
+    TestUpdateGroups();
+    TestMemoryResource();
+    TestCommandBuffer();
+    TestPruneUnusedChunks();
     TestEntityCloning();
     TestPrefabs();
+    TestBulkPrefabSpawning();
     TestDynamicMemoryComponent();
+    TestMixedComponentStorage();
 }
 
 }
@@ -8,7 +8,9 @@
 #include "test_correctness.h"
 #include "test_multi_threading.h"
 
+#include <atomic>
 #include <future>
+#include <thread>
 
 #include "../ecs/ecs.h"
 
@@ -106,6 +108,46 @@ void ExecuteMultiThreadingTest (ecs::Manager* mgr, EThreadingType threading) {
             for (auto i = 0; i < 4; ++i)
                 handle[i].wait();
         } break;
+        case EThreadingType::Scheduled: {
+            auto runDouble = [mgr]() {
+                mgr->RunJob<MultiThreadJobDouble>();
+                mgr->RunJob<MultiThreadSingletonJobDouble>();
+            };
+            auto runFloat = [mgr]() {
+                mgr->RunJob<MultiThreadJobFloat>();
+                mgr->RunJob<MultiThreadSingletonJobFloat>();
+            };
+            auto runInt = [mgr]() {
+                mgr->RunJob<MultiThreadJobInt>();
+                mgr->RunJob<MultiThreadSingletonJobInt>();
+            };
+            auto runUint = [mgr]() {
+                mgr->RunJob<MultiThreadJobUint>();
+                mgr->RunJob<MultiThreadSingletonJobUint>();
+            };
+            ecs::Scheduler& scheduler = mgr->GetScheduler();
+            ecs::TaskGroup group;
+            scheduler.Submit(group, runDouble);
+            scheduler.Submit(group, runFloat);
+            scheduler.Submit(group, runInt);
+            scheduler.Submit(group, runUint);
+            scheduler.Wait(group);
+        } break;
+        case EThreadingType::Graph: {
+            mgr->RunJobsMultithreaded<
+                MultiThreadJobDouble, MultiThreadSingletonJobDouble,
+                MultiThreadJobFloat, MultiThreadSingletonJobFloat,
+                MultiThreadJobInt, MultiThreadSingletonJobInt,
+                MultiThreadJobUint, MultiThreadSingletonJobUint
+            >();
+        } break;
+        case EThreadingType::Async: {
+            ecs::JobHandle doubles = mgr->RunJobAsync<MultiThreadSingletonJobDouble>(mgr->RunJobAsync<MultiThreadJobDouble>());
+            ecs::JobHandle floats = mgr->RunJobAsync<MultiThreadSingletonJobFloat>(mgr->RunJobAsync<MultiThreadJobFloat>());
+            ecs::JobHandle ints = mgr->RunJobAsync<MultiThreadSingletonJobInt>(mgr->RunJobAsync<MultiThreadJobInt>());
+            ecs::JobHandle uints = mgr->RunJobAsync<MultiThreadSingletonJobUint>(mgr->RunJobAsync<MultiThreadJobUint>());
+            mgr->Complete(mgr->CombineJobHandles(doubles, floats, ints, uints));
+        } break;
     }
     EXPECT_TRUE(mgr->GetSingletonComponent<test::SingletonDouble>()->Value == 2.0 * MULTI_THREAD_ENTITY_COUNT);
     EXPECT_TRUE(mgr->GetSingletonComponent<test::SingletonFloat>()->Value == 2.0f * MULTI_THREAD_ENTITY_COUNT);
@@ -119,6 +161,396 @@ void TestManualMultiThreading () {
     ExecuteMultiThreadingTest(&mgr, EThreadingType::ManualMulti);
 }
 
+struct ParallelJob : ecs::Job {
+    ECS_READ(ecs::Entity, Ent);
+    ECS_READ(test::IntA, A);
+    ECS_READ(test::IntB, B);
+    ECS_WRITE(test::IntC, C);
+
+    uint32_t m_visited = 0;
+
+    void ForEach () override {
+        C->Value = A->Value + B->Value;
+        if (A->Value % 10 == 0)
+            QueueAddComponents(*Ent, test::TagA{});
+        ++m_visited;
+    }
+};
+
+struct ParallelValidateJob : ecs::Job {
+    ECS_READ(test::IntA, A);
+    ECS_READ(test::IntC, C);
+    ECS_WRITE_SINGLETON(test::SingletonUint, Count);
+
+    void ForEach () override {
+        EXPECT_TRUE(C->Value == A->Value * 2);
+        Count->Value++;
+    }
+};
+
+void TestParallelJob () {
+    ecs::Manager mgr;
+
+    // Make sure the job is split even on machines with few cores
+    ecs::SchedulerSettings settings;
+    settings.threadCount = 4;
+    mgr.ConfigureScheduler(settings);
+
+    // Enough entities for many blocks, split across a few chunks
+    const int entityCount = 100000;
+    for (int i = 0; i < entityCount; ++i) {
+        if (i % 3 == 0)
+            mgr.CreateEntityImmediate(test::IntA{ i }, test::IntB{ i }, test::IntC{ 0 }, test::TagB{});
+        else
+            mgr.CreateEntityImmediate(test::IntA{ i }, test::IntB{ i }, test::IntC{ 0 });
+    }
+
+    mgr.RunJobParallel<ParallelJob>();
+    mgr.RunJob<ParallelValidateJob>();
+    EXPECT_TRUE(mgr.GetSingletonComponent<test::SingletonUint>()->Value == (uint32_t)entityCount);
+
+    // Commands queued by every worker are applied
+    struct CountTagA : ecs::Job {
+        ECS_REQUIRE(test::TagA);
+        ECS_READ(test::IntA, A);
+        ECS_WRITE_SINGLETON(test::SingletonInt, Count);
+        void ForEach () override {
+            EXPECT_TRUE(A->Value % 10 == 0);
+            Count->Value++;
+        }
+    };
+    mgr.RunJob<CountTagA>();
+    EXPECT_TRUE(mgr.GetSingletonComponent<test::SingletonInt>()->Value == entityCount / 10);
+}
+
+struct ParallelQueueJob : ecs::Job {
+    ECS_READ(ecs::Entity, Ent);
+    ECS_READ(test::IntA, A);
+    ECS_EXCLUDE(test::TagA);
+
+    void ForEach () override {
+        if (A->Value % 5 == 0) {
+            QueueCreateEntity(test::IntB{ A->Value });
+            QueueAddComponents(test::FloatA{ (float)A->Value });
+        }
+        // More than the block's share of reservations, the rest come after every earlier block's
+        if (A->Value % 20000 == 0) {
+            for (int32_t i = 0; i < 2000; ++i)
+                QueueCreateEntity(test::IntB{ -i });
+        }
+        if (A->Value % 7 == 0)
+            QueueDestroyEntity(*Ent);
+        else
+            QueueAddComponents(*Ent, test::TagA{});
+    }
+};
+
+// - Every entity with IntB, in the order jobs visit them
+static std::vector<std::pair<ecs::Entity, int32_t>> RunParallelQueueJob (uint32_t threadCount) {
+    ecs::Manager mgr;
+
+    ecs::SchedulerSettings settings;
+    settings.threadCount = threadCount;
+    mgr.ConfigureScheduler(settings);
+
+    for (int32_t i = 0; i < 100000; ++i) {
+        if (i % 2 == 0)
+            mgr.CreateEntityImmediate(test::IntA{ i }, test::TagB{});
+        else
+            mgr.CreateEntityImmediate(test::IntA{ i });
+    }
+
+    if (threadCount == 0)
+        mgr.RunJob<ParallelQueueJob>();
+    else
+        mgr.RunJobParallel<ParallelQueueJob>();
+
+    std::vector<std::pair<ecs::Entity, int32_t>> created;
+    mgr.ForEach<const ecs::Entity, const test::IntB>([&created](const ecs::Entity& entity, const test::IntB& ib) {
+        created.emplace_back(entity, ib.Value);
+    });
+    uint32_t tagged = 0;
+    mgr.ForEach<const test::IntA>(ecs::Filter().Require<test::TagA>(), [&tagged](const test::IntA& ia) {
+        EXPECT_TRUE(ia.Value % 7 != 0);
+        ++tagged;
+    });
+    EXPECT_TRUE(tagged == 100000 - 100000 / 7 - 1);
+    return created;
+}
+
+void TestParallelJobCommandOrder () {
+    // Queued commands are merged in block order, so results match RunJob for any thread count
+    const auto expected = RunParallelQueueJob(0);
+    EXPECT_TRUE(expected.size() == 100000 / 5 + 5 * 2000);
+    for (uint32_t threadCount : { 1u, 2u, 4u, 7u })
+        EXPECT_TRUE(RunParallelQueueJob(threadCount) == expected);
+}
+
+struct LoneCreatorJob : ecs::Job {
+    ECS_READ(test::IntA, A);
+
+    void ForEach () override {
+        if (A->Value < 0) {
+            for (int32_t i = 0; i < 200; ++i)
+                QueueCreateEntity(test::IntB{ i });
+        }
+    }
+};
+
+void TestParallelJobReservationGrowth () {
+    ecs::Manager mgr;
+
+    ecs::SchedulerSettings settings;
+    settings.threadCount = 4;
+    mgr.ConfigureScheduler(settings);
+
+    const uint32_t entityCount = 20000;
+    for (uint32_t i = 0; i < entityCount - 1; ++i)
+        mgr.CreateEntityImmediate(test::IntA{ (int32_t)i });
+    // The only entity that creates any, in the last block
+    mgr.CreateEntityImmediate(test::IntA{ -1 });
+
+    // Only blocks that reserved before set anything aside, so unused ranges don't pile up in entity data
+    const uint32_t runCount = 10;
+    for (uint32_t i = 0; i < runCount; ++i)
+        mgr.RunJobParallel<LoneCreatorJob>();
+
+    const uint32_t aliveCount = entityCount + runCount * 200;
+    EXPECT_TRUE(mgr.CreateEntityImmediate(test::IntC{ 0 }).index <= aliveCount);
+}
+
+void TestScheduler () {
+    for (uint32_t threadCount : { 1u, 4u }) {
+        ecs::SchedulerSettings settings;
+        settings.threadCount = threadCount;
+        ecs::Scheduler scheduler(settings);
+        EXPECT_TRUE(scheduler.GetThreadCount() == threadCount);
+
+        // Tasks that submit more tasks to their own worker's deque
+        std::atomic<uint32_t> count(0);
+        ecs::TaskGroup inner;
+        auto leaf = [&count]() { ++count; };
+        auto branch = [&scheduler, &inner, &leaf]() {
+            for (auto i = 0; i < 10; ++i)
+                scheduler.Submit(inner, leaf);
+        };
+
+        ecs::TaskGroup outer;
+        for (auto i = 0; i < 100; ++i)
+            scheduler.Submit(outer, branch);
+        scheduler.Wait(outer);
+        scheduler.Wait(inner);
+
+        EXPECT_TRUE(outer.IsDone());
+        EXPECT_TRUE(inner.IsDone());
+        EXPECT_TRUE(count == 1000);
+    }
+
+    ecs::Manager mgr;
+    ecs::SchedulerSettings settings;
+    settings.threadCount = 2;
+    settings.pinThreads = true;
+    mgr.ConfigureScheduler(settings);
+    EXPECT_TRUE(mgr.GetScheduler().GetThreadCount() == 2);
+
+    InitMultiThreadingTest(&mgr);
+    ExecuteMultiThreadingTest(&mgr, EThreadingType::Scheduled);
+}
+
+// A chain of jobs that only produce the right answer if run in order
+struct ChainJobA : ecs::Job {
+    ECS_WRITE(test::IntA, A);
+    void ForEach () override { A->Value += 1; }
+};
+
+struct ChainJobB : ecs::Job {
+    ECS_READ(test::IntA, A);
+    ECS_WRITE(test::IntB, B);
+    void ForEach () override { B->Value = A->Value * 2; }
+};
+
+struct ChainJobC : ecs::Job {
+    ECS_READ(test::IntB, B);
+    ECS_WRITE(test::IntC, C);
+    ECS_READ(ecs::Entity, Ent);
+    void ForEach () override {
+        C->Value = B->Value + 1;
+        if (C->Value == 5)
+            QueueAddComponents(*Ent, test::TagA{});
+    }
+};
+
+struct ChainJobIndependent : ecs::Job {
+    ECS_WRITE(test::FloatA, A);
+    void ForEach () override { A->Value += 1.0f; }
+};
+
+// Only the macros contribute to a job's signature, so these are checked with no Manager
+struct ChainJobDerived : ChainJobB {
+    ECS_READ_SINGLETON(test::SingletonInt, Total);
+};
+
+static_assert(ecs::CanMultithread<MultiThreadJobDouble, MultiThreadJobFloat, MultiThreadJobInt, MultiThreadJobUint>(), "Different components");
+static_assert(ecs::CanMultithread<MultiThreadJobDouble, MultiThreadSingletonJobFloat>(), "Different components");
+static_assert(!ecs::CanMultithread<MultiThreadJobDouble, MultiThreadSingletonJobDouble>(), "Write then read of DoubleC");
+static_assert(!ecs::CanMultithread<MultiThreadSingletonJobInt, MultiThreadJobInt>(), "Read then write of IntC");
+static_assert(!ecs::CanMultithread<ChainJobA, ChainJobA>(), "A job conflicts with itself");
+static_assert(!ecs::CanMultithread<ChainJobA, ChainJobIndependent, ChainJobDerived>(), "Inherited read of IntA");
+static_assert(!ecs::CanMultithread<MultiThreadSingletonJobInt, ChainJobDerived>(), "Singleton write then read");
+static_assert(ecs::CanMultithread<ChainJobB, ChainJobIndependent>(), "Different components");
+static_assert(ecs::CanMultithread<>(), "Nothing to conflict");
+
+void TestRunJobsMultithreaded () {
+    ecs::Manager mgr;
+
+    ecs::SchedulerSettings settings;
+    settings.threadCount = 4;
+    mgr.ConfigureScheduler(settings);
+
+    std::vector<ecs::Entity> entities;
+    for (auto i = 0; i < 1000; ++i)
+        entities.push_back(mgr.CreateEntityImmediate(test::IntA{ 0 }, test::IntB{ 0 }, test::IntC{ 0 }, test::FloatA{ 0.0f }));
+
+    for (auto i = 1; i <= 10; ++i) {
+        mgr.RunJobsMultithreaded<ChainJobIndependent, ChainJobA, ChainJobB, ChainJobC>();
+        for (auto entity : entities) {
+            EXPECT_TRUE(mgr.FindComponent<test::IntA>(entity)->Value == i);
+            EXPECT_TRUE(mgr.FindComponent<test::IntB>(entity)->Value == i * 2);
+            EXPECT_TRUE(mgr.FindComponent<test::IntC>(entity)->Value == i * 2 + 1);
+            EXPECT_TRUE(mgr.FindComponent<test::FloatA>(entity)->Value == (float)i);
+            EXPECT_TRUE(mgr.HasComponent<test::TagA>(entity) == (i >= 2));
+        }
+    }
+
+    ecs::Manager graphMgr;
+    graphMgr.ConfigureScheduler(settings);
+    InitMultiThreadingTest(&graphMgr);
+    ExecuteMultiThreadingTest(&graphMgr, EThreadingType::Graph);
+}
+
+void TestRunJobAsync () {
+    ecs::Manager mgr;
+
+    ecs::SchedulerSettings settings;
+    settings.threadCount = 4;
+    mgr.ConfigureScheduler(settings);
+
+    std::vector<ecs::Entity> entities;
+    for (auto i = 0; i < 1000; ++i)
+        entities.push_back(mgr.CreateEntityImmediate(test::IntA{ 0 }, test::IntB{ 0 }, test::IntC{ 0 }, test::FloatA{ 0.0f }));
+
+    for (auto i = 1; i <= 10; ++i) {
+        ecs::JobHandle a = mgr.RunJobAsync<ChainJobA>();
+        ecs::JobHandle b = mgr.RunJobAsync<ChainJobB>(a);
+        ecs::JobHandle c = mgr.RunJobAsync<ChainJobC>(b);
+        ecs::JobHandle independent = mgr.RunJobAsync<ChainJobIndependent>();
+
+        ecs::JobHandle all = mgr.CombineJobHandles(c, independent);
+        mgr.Complete(all);
+        EXPECT_TRUE(a.IsDone() && b.IsDone() && c.IsDone() && independent.IsDone() && all.IsDone());
+
+        for (auto entity : entities) {
+            EXPECT_TRUE(mgr.FindComponent<test::IntA>(entity)->Value == i);
+            EXPECT_TRUE(mgr.FindComponent<test::IntB>(entity)->Value == i * 2);
+            EXPECT_TRUE(mgr.FindComponent<test::IntC>(entity)->Value == i * 2 + 1);
+            EXPECT_TRUE(mgr.FindComponent<test::FloatA>(entity)->Value == (float)i);
+            EXPECT_TRUE(mgr.HasComponent<test::TagA>(entity) == (i >= 2));
+        }
+    }
+
+    // Runs of the same job wait on each other without being told to
+    mgr.RunJobAsync<ChainJobA>();
+    mgr.Complete(mgr.RunJobAsync<ChainJobA>());
+    EXPECT_TRUE(mgr.FindComponent<test::IntA>(entities[0])->Value == 12);
+
+    // Running a job directly completes its async run first
+    mgr.RunJobAsync<ChainJobA>();
+    mgr.RunJob<ChainJobA>();
+    mgr.RunJobAsync<ChainJobA>();
+    mgr.RunJobParallel<ChainJobA>();
+    for (auto entity : entities)
+        EXPECT_TRUE(mgr.FindComponent<test::IntA>(entity)->Value == 16);
+
+    EXPECT_TRUE(ecs::JobHandle().IsDone());
+    mgr.Complete(ecs::JobHandle());
+
+    ecs::Manager asyncMgr;
+    asyncMgr.ConfigureScheduler(settings);
+    InitMultiThreadingTest(&asyncMgr);
+    ExecuteMultiThreadingTest(&asyncMgr, EThreadingType::Async);
+}
+
+// Thread that is inside RunJobParallel, and how many async jobs ran on it
+struct ParallelWaitState : ecs::ISingletonComponent {
+    ECS_COMPONENT(ParallelWaitState)
+    std::atomic<std::thread::id> ParallelThread{ std::thread::id() };
+    std::atomic<uint32_t> AsyncOnParallelThread{ 0 };
+};
+
+template<int N>
+struct WaitStateAsyncJob : ecs::Job {
+    ECS_READ(test::IntB, B);
+    ECS_WRITE_SINGLETON(ParallelWaitState, State);
+
+    void Run () override {
+        if (State->ParallelThread.load() == std::this_thread::get_id())
+            ++State->AsyncOnParallelThread;
+        ecs::Job::Run();
+    }
+    void ForEach () override { m_total += B->Value; }
+
+    int64_t m_total = 0;
+};
+
+struct WaitStateParallelJob : ecs::Job {
+    ECS_WRITE(test::IntA, A);
+    void ForEach () override { A->Value += 1; }
+};
+
+struct WaitStateApplyJob : ecs::Job {
+    void Run () override { QueueCreateEntity(test::IntC{ 0 }); }
+};
+
+void TestParallelJobWaitWithAsyncJobs () {
+    ecs::Manager mgr;
+
+    ecs::SchedulerSettings settings;
+    settings.threadCount = 2;
+    mgr.ConfigureScheduler(settings);
+
+    std::vector<ecs::Entity> entities(20000);
+    mgr.CreateEntitiesImmediate(entities.data(), (uint32_t)entities.size(), test::IntA{ 0 }, test::IntB{ 1 });
+
+    // Applies commands over and over, so there is often a writer waiting on the locks
+    std::atomic<bool> stop(false);
+    std::thread applier([&mgr, &stop]() {
+        while (!stop)
+            mgr.RunJob<WaitStateApplyJob>();
+    });
+
+    // Async jobs take the locks RunJobParallel holds while it waits, it must not run them itself
+    ParallelWaitState* state = mgr.GetSingletonComponent<ParallelWaitState>();
+    const int32_t runCount = 20;
+    for (int32_t i = 0; i < runCount; ++i) {
+        ecs::JobHandle async = mgr.CombineJobHandles(
+            mgr.RunJobAsync<WaitStateAsyncJob<0>>(), mgr.RunJobAsync<WaitStateAsyncJob<1>>(),
+            mgr.RunJobAsync<WaitStateAsyncJob<2>>(), mgr.RunJobAsync<WaitStateAsyncJob<3>>());
+
+        state->ParallelThread = std::this_thread::get_id();
+        mgr.RunJobParallel<WaitStateParallelJob>();
+        state->ParallelThread = std::thread::id();
+
+        mgr.Complete(async);
+    }
+
+    stop = true;
+    applier.join();
+
+    EXPECT_TRUE(state->AsyncOnParallelThread == 0);
+    for (auto entity : entities)
+        EXPECT_TRUE(mgr.FindComponent<test::IntA>(entity)->Value == runCount);
+}
+
 void TestMultipleManagers () {
     const auto threadCount = 4;
     std::future<void> threads[threadCount];
@@ -13,12 +13,22 @@ const auto MULTI_THREAD_ENTITY_COUNT = 25000;
 
 enum EThreadingType : uint8_t {
     Single,
-    ManualMulti
+    ManualMulti,
+    Scheduled,
+    Graph,
+    Async
 };
 
 void InitMultiThreadingTest (ecs::Manager* mgr);
 void ExecuteMultiThreadingTest (ecs::Manager* mgr, EThreadingType threading);
 void TestManualMultiThreading ();
+void TestParallelJob ();
+void TestParallelJobCommandOrder ();
+void TestParallelJobReservationGrowth ();
+void TestScheduler ();
+void TestRunJobsMultithreaded ();
+void TestRunJobAsync ();
+void TestParallelJobWaitWithAsyncJobs ();
 void TestMultipleManagers ();
 
 }
@@ -49,6 +49,17 @@ void TestJobSpeed () {
     auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> elapsedJob = end - start;
 
+    start = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < loopCount; ++i) {
+        const float dt = mgr.GetSingletonComponent<test::DeltaTime>()->Value;
+        mgr.ForEach<test::FloatA, const test::FloatB, const test::FloatC>(ecs::Filter().Exclude<test::TagA>(),
+            [dt](test::FloatA& a, const test::FloatB& b, const test::FloatC& c) {
+                SpeedTestCalculation(dt, a.Value, b.Value, c.Value);
+            });
+    }
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsedForEach = end - start;
+
     uint64_t benchmarkLoops = entityCount * (uint64_t)loopCount;
     float a = 0;
     float b = 1000;
@@ -63,6 +74,12 @@ void TestJobSpeed () {
     EXPECT_FALSE(elapsedJob.count() > elapsedBenchmark.count() * maxRatio);
     if (elapsedJob.count() > elapsedBenchmark.count() * maxRatio)
         std::cout << "  " << elapsedJob.count() * 1000 << "ms vs " << elapsedBenchmark.count() * 1000 << "ms (" << 100 * elapsedJob.count() / elapsedBenchmark.count() << "%)" << std::endl;
+
+    // The lambda is inlined into a plain loop, so this should keep up with the hand-written one
+    double maxForEachRatio = 1.25;
+    EXPECT_FALSE(elapsedForEach.count() > elapsedBenchmark.count() * maxForEachRatio);
+    if (elapsedForEach.count() > elapsedBenchmark.count() * maxForEachRatio)
+        std::cout << "  " << elapsedForEach.count() * 1000 << "ms vs " << elapsedBenchmark.count() * 1000 << "ms (" << 100 * elapsedForEach.count() / elapsedBenchmark.count() << "%)" << std::endl;
 }
 
 void TestMultiThreadingSpeed () {
@@ -92,11 +109,30 @@ void TestMultiThreadingSpeed () {
         elapsedSingle = end - start;
     }
 
+    std::chrono::duration<double> elapsedScheduled;
+    {
+        ecs::Manager mgr;
+        InitMultiThreadingTest(&mgr);
+        mgr.GetScheduler();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (auto i = 0; i < loopCount; ++i)
+            ExecuteMultiThreadingTest(&mgr, EThreadingType::Scheduled);
+        auto end = std::chrono::high_resolution_clock::now();
+        elapsedScheduled = end - start;
+    }
+
     double maxRatio = 1.0;
     EXPECT_FALSE(elapsedManual.count() > elapsedSingle.count() * maxRatio);
     if (elapsedManual.count() > elapsedSingle.count() * maxRatio) {
         std::cout << "  " << elapsedManual.count() * 1000 << "ms vs " << elapsedSingle.count() * 1000 << "ms (" << 100 * elapsedManual.count() / elapsedSingle.count() << "%)" << std::endl;
     }
+
+    // No threads are created per frame, so this should beat spawning them
+    EXPECT_FALSE(elapsedScheduled.count() > elapsedManual.count());
+    if (elapsedScheduled.count() > elapsedManual.count()) {
+        std::cout << "  " << elapsedScheduled.count() * 1000 << "ms vs " << elapsedManual.count() * 1000 << "ms (" << 100 * elapsedScheduled.count() / elapsedManual.count() << "%)" << std::endl;
+    }
 }
 
 void TestSpeed () {